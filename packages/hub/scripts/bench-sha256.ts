@@ -0,0 +1,328 @@
+/**
+ * Throughput benchmark for the sha256 backends
+ *
+ * Usage: pnpm run bench:sha256 [--backends wasm,subtle,node,worker,native] [--sizes 0,1MiB,1GiB]
+ *   [--chunks 64KiB,1MiB,8MiB] [--max-size 16GiB] [--runs 3] [--workers 4]
+ *
+ * Prints one JSON object per line on stdout, and a human-readable summary on stderr:
+ *
+ * {"backend":"wasm","size":1048576,"chunkSize":65536,"runs":3,"medianMs":5.1,"minMs":5,"gbps":0.21,"callLatencyUs":318}
+ *
+ * - `gbps` is computed from the median run
+ * - `callLatencyUs` is the median run divided by the number of calls (`update()` for streaming backends, one call otherwise)
+ * - `worker` hashes one file per worker at the same time, `gbps` is the throughput of the whole pool
+ * - `crypto.subtle` and the worker need the whole message in memory, sizes above 1 GiB are reported with a `skipped` reason
+ *
+ * Compare `subtle` with `wasm` (browsers) or `node` (Node.js) to re-tune the `minSize` crossover of `sha256()`.
+ *
+ * The native backend needs `pnpm run build:native` and `HF_HUB_SHA256_ADDON`. For the raw block functions, without
+ * Node.js in the way, see src/vendor/hash-wasm/native/sha256-bench.c.
+ */
+
+import { createHash, randomFillSync } from "node:crypto";
+import { Worker } from "node:worker_threads";
+import { promisify } from "node:util";
+import { compileSHA256Module, createSHA256, createSHA256WorkerCode } from "../src/vendor/hash-wasm/sha256-wrapper";
+
+type Backend = "wasm" | "subtle" | "node" | "worker" | "native";
+
+interface Result {
+	backend: Backend;
+	size: number;
+	chunkSize: number | null;
+	runs?: number;
+	medianMs?: number;
+	minMs?: number;
+	gbps?: number;
+	callLatencyUs?: number;
+	skipped?: string;
+}
+
+const UNITS: Record<string, number> = { B: 1, KiB: 1024, MiB: 1024 ** 2, GiB: 1024 ** 3 };
+const SOURCE_SIZE = 64 * 1024 ** 2;
+const IN_MEMORY_MAX_SIZE = 1024 ** 3;
+
+function parseSize(value: string): number {
+	const match = /^(\d+(?:\.\d+)?)\s*(B|KiB|MiB|GiB)?$/.exec(value.trim());
+	if (!match) {
+		throw new TypeError(`Invalid size: ${value}`);
+	}
+	return Math.round(Number(match[1]) * UNITS[match[2] ?? "B"]);
+}
+
+function formatSize(size: number): string {
+	for (const unit of ["GiB", "MiB", "KiB"]) {
+		if (size >= UNITS[unit] && size % UNITS[unit] === 0) {
+			return `${size / UNITS[unit]}${unit}`;
+		}
+	}
+	return `${size}B`;
+}
+
+function parseArgs() {
+	const args = new Map<string, string>();
+	const argv = process.argv.slice(2);
+	for (let i = 0; i < argv.length; i += 2) {
+		if (!argv[i].startsWith("--") || argv[i + 1] === undefined) {
+			throw new TypeError(`Invalid argument: ${argv[i]}`);
+		}
+		args.set(argv[i].slice(2), argv[i + 1]);
+	}
+
+	const maxSize = parseSize(args.get("max-size") ?? "1GiB");
+	const sizes = (args.get("sizes") ?? "0,64,1KiB,64KiB,1MiB,10MiB,100MiB,1GiB,4GiB,16GiB")
+		.split(",")
+		.map(parseSize)
+		.filter((size) => size <= maxSize);
+
+	return {
+		backends: (args.get("backends") ?? "wasm,subtle,node,worker,native").split(",") as Backend[],
+		sizes,
+		chunks: (args.get("chunks") ?? "64KiB,1MiB,8MiB").split(",").map(parseSize),
+		runs: Number(args.get("runs") ?? 3),
+		workers: Number(args.get("workers") ?? 4),
+	};
+}
+
+/** Random bytes, repeated to build messages bigger than the source */
+const source = randomFillSync(new Uint8Array(SOURCE_SIZE));
+
+function* chunksOf(size: number, chunkSize: number): Generator<Uint8Array> {
+	for (let done = 0; done < size; ) {
+		const offset = done % SOURCE_SIZE;
+		const length = Math.min(chunkSize, size - done, SOURCE_SIZE - offset);
+		yield source.subarray(offset, offset + length);
+		done += length;
+	}
+}
+
+function message(size: number): Uint8Array {
+	if (size <= SOURCE_SIZE) {
+		return source.subarray(0, size);
+	}
+	const result = new Uint8Array(size);
+	let done = 0;
+	for (const chunk of chunksOf(size, SOURCE_SIZE)) {
+		result.set(chunk, done);
+		done += chunk.length;
+	}
+	return result;
+}
+
+async function measure(
+	backend: Backend,
+	size: number,
+	chunkSize: number | null,
+	runs: number,
+	run: () => Promise<number> | number
+): Promise<Result> {
+	// Warm-up, compiles the WASM module / spawns the workers
+	await run();
+
+	const durations: number[] = [];
+	let calls = 1;
+	for (let i = 0; i < runs; i++) {
+		const start = performance.now();
+		calls = await run();
+		durations.push(performance.now() - start);
+	}
+	durations.sort((a, b) => a - b);
+	const medianMs = durations[Math.floor(durations.length / 2)];
+
+	return {
+		backend,
+		size,
+		chunkSize,
+		runs,
+		medianMs: Number(medianMs.toFixed(3)),
+		minMs: Number(durations[0].toFixed(3)),
+		gbps: medianMs ? Number((size / medianMs / 1e6).toFixed(3)) : 0,
+		callLatencyUs: Number(((medianMs * 1000) / Math.max(1, calls)).toFixed(3)),
+	};
+}
+
+interface NativeAddon {
+	backend: string;
+	createHash(): object;
+	update(hash: object, data: Uint8Array, callback: (err: Error | null) => void): void;
+	digest(hash: object): string;
+}
+
+function loadNativeAddon(): NativeAddon | undefined {
+	const path = process.env.HF_HUB_SHA256_ADDON;
+	if (!path) {
+		return undefined;
+	}
+	const module = { exports: {} };
+	process.dlopen(module, path);
+	return module.exports as NativeAddon;
+}
+
+/**
+ * Same code as the browser worker pool, with `self` and `postMessage` mapped on worker_threads
+ */
+async function createWorkerPool(count: number) {
+	const code = `
+		const { parentPort } = require("node:worker_threads");
+		globalThis.self = globalThis;
+		self.addEventListener = (type, listener) => parentPort.on(type, (data) => listener({ data }));
+		globalThis.postMessage = (data) => parentPort.postMessage(data);
+		${createSHA256WorkerCode()}
+	`;
+	const module = await compileSHA256Module();
+	const workers = Array.from({ length: count }, () => new Worker(code, { eval: true }));
+	for (const worker of workers) {
+		worker.postMessage({ module });
+	}
+
+	return {
+		async hash(files: Blob[]): Promise<void> {
+			let next = 0;
+			await Promise.all(
+				workers.map(async (worker) => {
+					while (next < files.length) {
+						const file = files[next++];
+						await new Promise<void>((resolve, reject) => {
+							const onMessage = (data: { sha256?: string }) => {
+								if (data.sha256) {
+									worker.off("message", onMessage);
+									worker.off("error", reject);
+									resolve();
+								}
+							};
+							worker.on("message", onMessage);
+							worker.once("error", reject);
+							worker.postMessage({ file });
+						});
+					}
+				})
+			);
+		},
+		terminate: () => Promise.all(workers.map((worker) => worker.terminate())),
+	};
+}
+
+async function main() {
+	const { backends, sizes, chunks, runs, workers } = parseArgs();
+	const results: Result[] = [];
+	const report = (result: Result) => {
+		results.push(result);
+		process.stdout.write(JSON.stringify(result) + "\n");
+		const chunk = result.chunkSize === null ? "" : ` chunk ${formatSize(result.chunkSize)}`;
+		process.stderr.write(
+			`${result.backend.padEnd(7)} ${formatSize(result.size).padStart(7)}${chunk.padEnd(14)} ` +
+				(result.skipped ? `skipped: ${result.skipped}\n` : `${result.gbps} GB/s, ${result.callLatencyUs} µs/call\n`)
+		);
+	};
+
+	const native = backends.includes("native") ? loadNativeAddon() : undefined;
+	const pool = backends.includes("worker") ? await createWorkerPool(workers) : undefined;
+
+	try {
+		for (const size of sizes) {
+			for (const backend of backends) {
+				switch (backend) {
+					case "wasm": {
+						const sha256 = await createSHA256();
+						for (const chunkSize of chunks) {
+							report(
+								await measure(backend, size, chunkSize, runs, () => {
+									let calls = 0;
+									sha256.init();
+									for (const chunk of chunksOf(size, chunkSize)) {
+										sha256.update(chunk);
+										calls++;
+									}
+									sha256.digest("hex");
+									return calls;
+								})
+							);
+						}
+						break;
+					}
+					case "node": {
+						for (const chunkSize of chunks) {
+							report(
+								await measure(backend, size, chunkSize, runs, () => {
+									let calls = 0;
+									const hash = createHash("sha256");
+									for (const chunk of chunksOf(size, chunkSize)) {
+										hash.update(chunk);
+										calls++;
+									}
+									hash.digest("hex");
+									return calls;
+								})
+							);
+						}
+						break;
+					}
+					case "native": {
+						if (!native) {
+							report({ backend, size, chunkSize: null, skipped: "HF_HUB_SHA256_ADDON is not set" });
+							break;
+						}
+						const update = promisify(native.update);
+						for (const chunkSize of chunks) {
+							report(
+								await measure(backend, size, chunkSize, runs, async () => {
+									let calls = 0;
+									const hash = native.createHash();
+									for (const chunk of chunksOf(size, chunkSize)) {
+										await update(hash, chunk);
+										calls++;
+									}
+									native.digest(hash);
+									return calls;
+								})
+							);
+						}
+						break;
+					}
+					case "subtle": {
+						if (size > IN_MEMORY_MAX_SIZE) {
+							report({ backend, size, chunkSize: null, skipped: "needs the whole message in memory" });
+							break;
+						}
+						const data = message(size);
+						report(
+							await measure(backend, size, null, runs, async () => {
+								await globalThis.crypto.subtle.digest("SHA-256", data);
+								return 1;
+							})
+						);
+						break;
+					}
+					case "worker": {
+						if (size > IN_MEMORY_MAX_SIZE || !pool) {
+							report({ backend, size, chunkSize: null, skipped: "needs the whole message in memory" });
+							break;
+						}
+						// As many files as workers, to measure the throughput of the whole pool
+						const files = Array.from({ length: workers }, () => new Blob([message(size)]));
+						const result = await measure(backend, size * workers, null, runs, async () => {
+							await pool.hash(files);
+							return workers;
+						});
+						report({ ...result, size });
+						break;
+					}
+					default:
+						throw new TypeError(`Unknown backend: ${backend}`);
+				}
+			}
+		}
+	} finally {
+		await pool?.terminate();
+	}
+
+	if (native) {
+		process.stderr.write(`native backend: ${native.backend}\n`);
+	}
+	process.stderr.write(`${results.length} results\n`);
+}
+
+main().catch((err) => {
+	console.error(err);
+	process.exit(1);
+});
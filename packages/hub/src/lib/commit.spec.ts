@@ -1,4 +1,4 @@
-import { assert, it, describe } from "vitest";
+import { assert, it, describe, expect } from "vitest";
 
 import { TEST_HUB_URL, TEST_ACCESS_TOKEN, TEST_USER } from "../test/consts";
 import type { RepoId } from "../types/public";
@@ -204,4 +204,79 @@ size 4194304
 		}
 		// https://huggingfacejs-push-model-from-web.hf.space/
 	}, 60_000);
+
+	it("should fail as soon as an upload fails, while other files are still being processed", async () => {
+		// 100 files fill the first LFS batch request, the last one goes in a second request that is never answered.
+		// Only one file of the first batch needs uploading, the upload queue is then waiting for the next one.
+		const operations: CommitFile[] = Array.from({ length: 101 }, (_, i) => ({
+			operation: "addOrUpdate",
+			path: `file-${i}.bin`,
+			content: new Blob([`content of file ${i}`]),
+		}));
+		const mockFetch: typeof fetch = async (input, init) => {
+			const url = String(input);
+			const body = typeof init?.body === "string" ? JSON.parse(init.body) : undefined;
+			if (url.includes("/preupload/")) {
+				return new Response(
+					JSON.stringify({
+						files: body.files.map((file: { path: string }) => ({ path: file.path, uploadMode: "lfs" })),
+					})
+				);
+			}
+			if (url.endsWith("/info/lfs/objects/batch")) {
+				if (body.objects.length < 100) {
+					// Only settles once the commit is aborted
+					return new Promise((_, reject) =>
+						init?.signal?.addEventListener("abort", () => reject(init.signal?.reason))
+					);
+				}
+				return new Response(
+					JSON.stringify({
+						objects: body.objects.map((obj: { oid: string; size: number }, i: number) => ({
+							...obj,
+							...(i === 0 && { actions: { upload: { href: `https://storage.test/${obj.oid}` } } }),
+						})),
+					})
+				);
+			}
+			if (url.startsWith("https://storage.test/")) {
+				return new Response("upload failed", { status: 500 });
+			}
+			throw new Error(`Unexpected request to ${url}`);
+		};
+
+		await expect(
+			commit({
+				repo: { name: "test/upload-failure", type: "model" },
+				title: "Some commit",
+				hubUrl: "https://hub.test",
+				operations,
+				fetch: mockFetch,
+			})
+		).rejects.toThrow("Error while uploading file-");
+	});
+
+	it("should stop listing the remote files when aborted with skipUnchanged", async () => {
+		const requests: string[] = [];
+		const mockFetch: typeof fetch = async (input, init) => {
+			requests.push(String(input));
+			// The listing only settles once the commit is aborted
+			return new Promise((_, reject) => init?.signal?.addEventListener("abort", () => reject(init.signal?.reason)));
+		};
+		const abortController = new AbortController();
+		setTimeout(() => abortController.abort(), 100);
+
+		await expect(
+			commit({
+				repo: { name: "test/abort-listing", type: "model" },
+				title: "Some commit",
+				hubUrl: "https://hub.test",
+				operations: [{ operation: "addOrUpdate", path: "file.txt", content: new Blob(["content"]) }],
+				skipUnchanged: true,
+				abortSignal: abortController.signal,
+				fetch: mockFetch,
+			})
+		).rejects.toThrow();
+		expect(requests).toEqual(["https://hub.test/api/models/test/abort-listing/tree/main?recursive=true&expand=false"]);
+	});
 });
@@ -7,6 +7,7 @@ import type {
 	ApiLfsBatchRequest,
 	ApiLfsBatchResponse,
 	ApiLfsCompleteMultipartRequest,
+	ApiLfsResponseObject,
 	ApiPreuploadRequest,
 	ApiPreuploadResponse,
 } from "../types/api/api-commit";
@@ -15,17 +16,51 @@ import { checkCredentials } from "../utils/checkCredentials";
 import { chunk } from "../utils/chunk";
 import { promisesQueue } from "../utils/promisesQueue";
 import { promisesQueueStreaming } from "../utils/promisesQueueStreaming";
-import { sha256 } from "../utils/sha256";
+import { sha256, sha256Batch, sha256Files } from "../utils/sha256";
+import type { SHA256Cache } from "../utils/sha256";
 import { toRepoId } from "../utils/toRepoId";
 import { WebBlob } from "../utils/WebBlob";
 import { createBlob } from "../utils/createBlob";
 import { eventToGenerator } from "../utils/eventToGenerator";
 import { base64FromBytes } from "../utils/base64FromBytes";
 import { isFrontend } from "../utils/isFrontend";
+import { AdaptiveConcurrency } from "../utils/AdaptiveConcurrency";
+import { hardwareConcurrency } from "../utils/hardwareConcurrency";
+import { createAsyncQueue } from "../utils/createAsyncQueue";
+import { gitBlobSha1 } from "../utils/gitBlobSha1";
+import { multiDigest } from "../utils/multiDigest";
+import type { ListFileEntry } from "./list-files";
+import { listFiles } from "./list-files";
 
-const CONCURRENT_SHAS = 5;
-const CONCURRENT_LFS_UPLOADS = 5;
 const MULTIPART_PARALLEL_UPLOAD = 5;
+/** Number of attempts to upload each part of a multipart upload */
+const MULTIPART_PART_ATTEMPTS = 3;
+/** Delay before uploading a failed part again, multiplied by the number of failed attempts, in ms */
+const MULTIPART_PART_RETRY_DELAY = 1000;
+/** A LFS batch request is sent as soon as this many files are hashed... */
+const LFS_BATCH_MAX_FILES = 100;
+/** ...or this long after the first file waiting for it was hashed, in ms */
+const LFS_BATCH_DELAY = 200;
+/** LFS files below this size are hashed together with sha256Batch */
+const SHA256_BATCH_MAX_FILE_SIZE = 1_000_000;
+/**
+ * Files above this size are hashed during the preupload calls, before the server says if they're stored with LFS,
+ * since they almost always are
+ */
+const SPECULATIVE_HASH_MIN_SIZE = 10_000_000;
+/** Number of files looked up in the hash cache at the same time */
+const HASH_CACHE_CONCURRENCY = 64;
+/** Number of regular files hashed at the same time with `skipUnchanged`, to compare them with the remote ones */
+const GIT_BLOB_SHA1_CONCURRENCY = 16;
+
+interface HashTask {
+	/** Progress (0-1) of the computation */
+	progress: number;
+	/** Undefined if the computation was aborted before it started */
+	sha: Promise<string | undefined>;
+	onProgress?: (progress: number) => void;
+	abort: () => void;
+}
 
 export interface CommitDeletedEntry {
 	operation: "delete";
@@ -75,8 +110,41 @@ export interface CommitParams {
 	 * Whether to use web workers to compute SHA256 hashes.
 	 *
 	 * We load hash-wasm from a CDN inside the web worker. Not sure how to do otherwise and still have a "clean" bundle.
+	 *
+	 * On cross-origin isolated pages, workers report progress through shared memory, read every `progressInterval` ms
+	 * (default 100), instead of posting a message per chunk.
+	 *
+	 * The pool size defaults to the number of cores.
+	 */
+	useWebWorkers?: boolean | { minSize?: number; poolSize?: number; progressInterval?: number };
+	/**
+	 * Reuse the shas of LFS files that didn't change since they were last hashed.
+	 *
+	 * In Node.js, a path is the file where the shas of local files are stored, keyed by path, size, modification time
+	 * and inode. With `fingerprint`, a few sampled ranges of each file are also compared, at the cost of reading them.
+	 *
+	 * In the browser, a path is the name of the IndexedDB database where the shas of `File`s are stored, keyed by name,
+	 * size and last modification time. `fingerprint` works the same way.
 	 */
-	useWebWorkers?: boolean | { minSize?: number; poolSize?: number };
+	hashCache?: string | { path: string; fingerprint?: boolean } | SHA256Cache;
+	/**
+	 * Leave out the files whose content is already in the repository at the same path.
+	 *
+	 * Files are compared with the tree of `parentCommit`, or of the branch: regular files by git object id, LFS files
+	 * by sha256, which is then reused for the upload. Only files with the same size as the remote one are hashed
+	 * for the comparison.
+	 */
+	skipUnchanged?: boolean;
+	/**
+	 * Send the sha256 of each part of multipart LFS uploads, as `x-amz-checksum-sha256`, so that the storage rejects
+	 * corrupted parts. Failed parts are uploaded again, checksums or not.
+	 *
+	 * The part size is set by the server. If it is known, `partSize` lets the part digests be computed while hashing
+	 * the file. Otherwise, or if the server uses a different part size, each part is hashed right before its upload.
+	 *
+	 * The storage must accept checksums for this to work.
+	 */
+	partChecksums?: boolean | { partSize: number };
 	/**
 	 * Custom fetch function to use instead of the default one, for example to use a proxy or edit headers.
 	 */
@@ -126,6 +194,15 @@ export async function* commitIter(params: CommitParams): AsyncGenerator<CommitPr
 	yield { event: "phase", phase: "preuploading" };
 
 	const lfsShas = new Map<string, string | null>();
+	/** sha256() computations, by path */
+	const hashTasks = new Map<string, HashTask>();
+	const hashQueue = createAsyncQueue<() => Promise<void>>();
+	/** Shas found in the hash cache, by path */
+	const cachedShas = new Map<string, string>();
+	/** Shas of the parts of LFS files, computed while hashing them, by path */
+	const partShas = new Map<string, { partSize: number; shas: string[] }>();
+	const partChecksumSize = typeof params.partChecksums === "object" ? params.partChecksums.partSize : undefined;
+	let closeHashCache: (() => Promise<void>) | undefined;
 
 	const abortController = new AbortController();
 	const abortSignal = abortController.signal;
@@ -144,7 +221,7 @@ export async function* commitIter(params: CommitParams): AsyncGenerator<CommitPr
 	}
 
 	try {
-		const allOperations = await Promise.all(
+		let allOperations = await Promise.all(
 			params.operations.map(async (operation) => {
 				if (operation.operation !== "addOrUpdate") {
 					return operation;
@@ -166,6 +243,141 @@ export async function* commitIter(params: CommitParams): AsyncGenerator<CommitPr
 			})
 		);
 
+		const concurrency = new AdaptiveConcurrency({ cores: await hardwareConcurrency() });
+		// Without a pool size, each file would get its own worker
+		const useWebWorkers = params.useWebWorkers && {
+			...(typeof params.useWebWorkers === "object" && params.useWebWorkers),
+			poolSize: (typeof params.useWebWorkers === "object" && params.useWebWorkers.poolSize) || concurrency.maxHashing,
+		};
+
+		const hashCache = await openHashCache(params.hashCache);
+		closeHashCache = hashCache?.close;
+		if (hashCache) {
+			await promisesQueue(
+				allOperations.filter(isFileOperation).map((op) => async () => {
+					const sha = await hashCache.cache.get(op.content);
+					if (sha) {
+						cachedShas.set(op.path, sha);
+					}
+				}),
+				HASH_CACHE_CONCURRENCY
+			);
+		}
+
+		const enqueueHash = (op: CommitBlob): HashTask => {
+			const controller = new AbortController();
+			abortSignal.addEventListener("abort", () => controller.abort(), { once: true });
+			const sha = new Promise<string | undefined>((resolve, reject) => {
+				hashQueue.push(async () => {
+					if (controller.signal.aborted) {
+						resolve(undefined);
+						return;
+					}
+					const stream = concurrency.hashStarted();
+					try {
+						const iterator =
+							partChecksumSize && op.content.size > partChecksumSize
+								? sha256WithParts(op.content, partChecksumSize, controller.signal, (shas) =>
+										partShas.set(op.path, { partSize: partChecksumSize, shas })
+								  )
+								: sha256(op.content, { useWebWorker: useWebWorkers, abortSignal: controller.signal });
+						let res: IteratorResult<number, string>;
+						do {
+							res = await iterator.next();
+							if (!res.done) {
+								task.progress = res.value;
+								stream.progress(res.value * op.content.size);
+								task.onProgress?.(res.value);
+							}
+						} while (!res.done);
+						resolve(res.value);
+					} catch (err) {
+						reject(err);
+					} finally {
+						stream.end();
+					}
+				});
+			});
+			// Speculative hashes of files that are not stored with LFS are never awaited
+			sha.catch(() => {});
+			const task: HashTask = { progress: 0, sha, abort: () => controller.abort() };
+			hashTasks.set(op.path, task);
+			return task;
+		};
+
+		const hashing = promisesQueueStreaming(hashQueue, () => concurrency.hashConcurrency);
+		// Awaited with the uploads, a failure before that aborts the commit right away with its error
+		hashing.catch((err) => abortController.abort(err));
+
+		if (params.skipUnchanged && allOperations.some(isFileOperation)) {
+			const remoteFiles = new Map<string, ListFileEntry>();
+			try {
+				for await (const file of listFiles({
+					repo: params.repo,
+					recursive: true,
+					revision: encodeURIComponent(params.parentCommit ?? params.branch ?? "main"),
+					credentials: params.credentials,
+					hubUrl: params.hubUrl,
+					fetch: params.fetch,
+					abortSignal,
+				})) {
+					remoteFiles.set(file.path, file);
+				}
+			} catch (err) {
+				// Empty repository, everything is new
+				if (!(err instanceof HubApiError && err.statusCode === 404)) {
+					throw err;
+				}
+			}
+
+			abortSignal.throwIfAborted();
+
+			const unchanged = new Set<string>();
+			const candidates = allOperations.filter(isFileOperation).filter((op) => {
+				const remote = remoteFiles.get(op.path);
+				return remote?.type === "file" && (remote.lfs?.size ?? remote.size) === op.content.size;
+			});
+
+			yield* eventToGenerator<CommitProgressEvent, void>((yieldCallback, returnCallback, rejectCallback) =>
+				Promise.all([
+					promisesQueue(
+						candidates
+							.filter((op) => !remoteFiles.get(op.path)?.lfs)
+							.map((op) => async () => {
+								if ((await gitBlobSha1(op.content, { abortSignal })) === remoteFiles.get(op.path)?.oid) {
+									unchanged.add(op.path);
+								}
+							}),
+						GIT_BLOB_SHA1_CONCURRENCY
+					),
+					...candidates
+						.filter((op) => remoteFiles.get(op.path)?.lfs)
+						.map(async (op) => {
+							let sha = cachedShas.get(op.path);
+							if (!sha) {
+								// Hashed like any LFS file, the task is picked up later if the file changed
+								const task = enqueueHash(op);
+								task.onProgress = (progress) =>
+									yieldCallback({ event: "fileProgress", path: op.path, progress, state: "hashing" });
+								sha = await task.sha;
+							}
+							if (sha === remoteFiles.get(op.path)?.lfs?.oid) {
+								unchanged.add(op.path);
+							}
+						}),
+				]).then(() => returnCallback(), rejectCallback)
+			);
+
+			allOperations = allOperations.filter((op) => !unchanged.has(op.path));
+		}
+
+		// Big files almost always end up in LFS, start hashing them while the preupload calls are made
+		for (const op of allOperations.filter(isFileOperation)) {
+			if (op.content.size >= SPECULATIVE_HASH_MIN_SIZE && !cachedShas.has(op.path) && !hashTasks.has(op.path)) {
+				enqueueHash(op);
+			}
+		}
+
 		const gitAttributes = allOperations.filter(isFileOperation).find((op) => op.path === ".gitattributes")?.content;
 
 		for (const operations of chunk(allOperations.filter(isFileOperation), 100)) {
@@ -210,146 +422,125 @@ export async function* commitIter(params: CommitParams): AsyncGenerator<CommitPr
 			}
 		}
 
-		yield { event: "phase", phase: "uploadingLargeFiles" };
-
-		for (const operations of chunk(
-			allOperations.filter(isFileOperation).filter((op) => lfsShas.has(op.path)),
-			100
-		)) {
-			const shas = yield* eventToGenerator<
-				{ event: "fileProgress"; state: "hashing"; path: string; progress: number },
-				string[]
-			>((yieldCallback, returnCallback, rejectCallack) => {
-				return promisesQueue(
-					operations.map((op) => async () => {
-						const iterator = sha256(op.content, { useWebWorker: params.useWebWorkers, abortSignal: abortSignal });
-						let res: IteratorResult<number, string>;
-						do {
-							res = await iterator.next();
-							if (!res.done) {
-								yieldCallback({ event: "fileProgress", path: op.path, progress: res.value, state: "hashing" });
-							}
-						} while (!res.done);
-						const sha = res.value;
-						lfsShas.set(op.path, res.value);
-						return sha;
-					}),
-					CONCURRENT_SHAS
-				).then(returnCallback, rejectCallack);
-			});
-
-			abortSignal?.throwIfAborted();
-
-			const payload: ApiLfsBatchRequest = {
-				operation: "upload",
-				// multipart is a custom protocol for HF
-				transfers: ["basic", "multipart"],
-				hash_algo: "sha_256",
-				...(!params.isPullRequest && {
-					ref: {
-						name: params.branch ?? "main",
-					},
-				}),
-				objects: operations.map((op, i) => ({
-					oid: shas[i],
-					size: op.content.size,
-				})),
-			};
-
-			const res = await (params.fetch ?? fetch)(
-				`${params.hubUrl ?? HUB_URL}/${repoId.type === "model" ? "" : repoId.type + "s/"}${
-					repoId.name
-				}.git/info/lfs/objects/batch`,
-				{
-					method: "POST",
-					headers: {
-						...(params.credentials && { Authorization: `Bearer ${params.credentials.accessToken}` }),
-						Accept: "application/vnd.git-lfs+json",
-						"Content-Type": "application/vnd.git-lfs+json",
-					},
-					body: JSON.stringify(payload),
-					signal: abortSignal,
-				}
-			);
-
-			if (!res.ok) {
-				throw await createApiError(res);
+		for (const [path, task] of hashTasks) {
+			if (!lfsShas.has(path)) {
+				task.abort();
 			}
+		}
 
-			const json: ApiLfsBatchResponse = await res.json();
-			const batchRequestId = res.headers.get("X-Request-Id") || undefined;
+		yield { event: "phase", phase: "uploadingLargeFiles" };
 
-			const shaToOperation = new Map(operations.map((op, i) => [shas[i], op]));
+		const lfsOperations = allOperations.filter(isFileOperation).filter((op) => lfsShas.has(op.path));
+		/** Files to hash, that are not already being hashed */
+		const unhashedOperations = lfsOperations.filter((op) => !hashTasks.has(op.path) && !cachedShas.has(op.path));
+		const smallOperations = unhashedOperations.filter((op) => op.content.size < SHA256_BATCH_MAX_FILE_SIZE);
+		const batchedOperations = smallOperations.length > 1 ? smallOperations : [];
+		// Files getting part digests stay on the main thread: the workers only compute the digest of the whole file,
+		// and their parts would be read again for hashing right before their upload
+		const workerOperations =
+			isFrontend && useWebWorkers
+				? unhashedOperations.filter(
+						(op) => !batchedOperations.includes(op) && !(partChecksumSize && op.content.size > partChecksumSize)
+				  )
+				: [];
+		for (const op of unhashedOperations) {
+			if (!batchedOperations.includes(op) && !workerOperations.includes(op)) {
+				enqueueHash(op);
+			}
+		}
+		hashQueue.close();
+
+		// Files are sent to LFS batch requests as soon as they're hashed, and uploaded while the next ones are hashed
+		yield* eventToGenerator<CommitProgressEvent, void>((yieldCallback, returnCallback, rejectCallback) => {
+			const uploads = createAsyncQueue<() => Promise<void>>();
+			const batchRequests: Promise<void>[] = [];
+			/** Hashed files waiting for a LFS batch request */
+			let hashedOperations: CommitBlob[] = [];
+			let batchTimer: ReturnType<typeof setTimeout> | undefined;
+			const cacheWrites: Promise<void>[] = [];
+
+			const uploadLfsObject = async (
+				op: CommitBlob,
+				obj: ApiLfsResponseObject,
+				batchUrl: string,
+				batchRequestId: string | undefined
+			) => {
+				abortSignal?.throwIfAborted();
 
-			yield* eventToGenerator<CommitProgressEvent, void>((yieldCallback, returnCallback, rejectCallback) => {
-				return promisesQueueStreaming(
-					json.objects.map((obj) => async () => {
-						const op = shaToOperation.get(obj.oid);
+				if (obj.error) {
+					const errorMessage = `Error while doing LFS batch call for ${op.path}: ${obj.error.message}${
+						batchRequestId ? ` - Request ID: ${batchRequestId}` : ""
+					}`;
+					throw new HubApiError(batchUrl, obj.error.code, batchRequestId, errorMessage);
+				}
+				if (!obj.actions?.upload) {
+					// Already uploaded
+					yieldCallback({
+						event: "fileProgress",
+						path: op.path,
+						progress: 1,
+						state: "uploading",
+					});
+					return;
+				}
+				yieldCallback({
+					event: "fileProgress",
+					path: op.path,
+					progress: 0,
+					state: "uploading",
+				});
+				const content = op.content;
+				const header = obj.actions.upload.header;
+				if (header?.chunk_size) {
+					const chunkSize = parseInt(header.chunk_size);
+
+					// multipart upload
+					// parts are in upload.header['00001'] to upload.header['99999']
+
+					const completionUrl = obj.actions.upload.href;
+					const parts = Object.keys(header).filter((key) => /^[0-9]+$/.test(key));
+
+					if (parts.length !== Math.ceil(content.size / chunkSize)) {
+						throw new Error("Invalid server response to upload large LFS file, wrong number of parts");
+					}
 
-						if (!op) {
-							throw new InvalidApiResponseFormatError("Unrequested object ID in response");
-						}
+					const completeReq: ApiLfsCompleteMultipartRequest = {
+						oid: obj.oid,
+						parts: parts.map((part) => ({
+							partNumber: +part,
+							etag: "",
+						})),
+					};
 
-						abortSignal?.throwIfAborted();
+					// Defined here so that it's not redefined at each iteration (and the caller can tell it's for the same file)
+					const progressCallback = (progress: number) =>
+						yieldCallback({ event: "fileProgress", path: op.path, progress, state: "uploading" });
 
-						if (obj.error) {
-							const errorMessage = `Error while doing LFS batch call for ${operations[shas.indexOf(obj.oid)].path}: ${
-								obj.error.message
-							}${batchRequestId ? ` - Request ID: ${batchRequestId}` : ""}`;
-							throw new HubApiError(res.url, obj.error.code, batchRequestId, errorMessage);
-						}
-						if (!obj.actions?.upload) {
-							// Already uploaded
-							yieldCallback({
-								event: "fileProgress",
-								path: op.path,
-								progress: 1,
-								state: "uploading",
-							});
-							return;
-						}
-						yieldCallback({
-							event: "fileProgress",
-							path: op.path,
-							progress: 0,
-							state: "uploading",
-						});
-						const content = op.content;
-						const header = obj.actions.upload.header;
-						if (header?.chunk_size) {
-							const chunkSize = parseInt(header.chunk_size);
+					const precomputedShas = partShas.get(op.path);
+					partShas.delete(op.path);
 
-							// multipart upload
-							// parts are in upload.header['00001'] to upload.header['99999']
+					await promisesQueueStreaming(
+						parts.map((part) => async () => {
+							abortSignal?.throwIfAborted();
 
-							const completionUrl = obj.actions.upload.href;
-							const parts = Object.keys(header).filter((key) => /^[0-9]+$/.test(key));
+							const index = parseInt(part) - 1;
+							const slice = content.slice(index * chunkSize, (index + 1) * chunkSize);
 
-							if (parts.length !== Math.ceil(content.size / chunkSize)) {
-								throw new Error("Invalid server response to upload large LFS file, wrong number of parts");
+							let checksum: string | undefined;
+							if (params.partChecksums) {
+								const sha =
+									precomputedShas?.partSize === chunkSize
+										? precomputedShas.shas[index]
+										: await drainSha256(sha256(slice, { abortSignal }));
+								checksum = base64FromBytes(Uint8Array.from(sha.match(/../g) ?? [], (byte) => parseInt(byte, 16)));
 							}
 
-							const completeReq: ApiLfsCompleteMultipartRequest = {
-								oid: obj.oid,
-								parts: parts.map((part) => ({
-									partNumber: +part,
-									etag: "",
-								})),
-							};
-
-							// Defined here so that it's not redefined at each iteration (and the caller can tell it's for the same file)
-							const progressCallback = (progress: number) =>
-								yieldCallback({ event: "fileProgress", path: op.path, progress, state: "uploading" });
-
-							await promisesQueueStreaming(
-								parts.map((part) => async () => {
-									abortSignal?.throwIfAborted();
-
-									const index = parseInt(part) - 1;
-									const slice = content.slice(index * chunkSize, (index + 1) * chunkSize);
-
-									const res = await (params.fetch ?? fetch)(header[part], {
+							let res: Response;
+							for (let attempt = 1; ; attempt++) {
+								try {
+									res = await (params.fetch ?? fetch)(header[part], {
 										method: "PUT",
+										headers: checksum ? { "x-amz-checksum-sha256": checksum } : undefined,
 										/** Unfortunately, browsers don't support our inherited version of Blob in fetch calls */
 										body: slice instanceof WebBlob && isFrontend ? await slice.arrayBuffer() : slice,
 										signal: abortSignal,
@@ -363,97 +554,255 @@ export async function* commitIter(params: CommitParams): AsyncGenerator<CommitPr
 											// eslint-disable-next-line @typescript-eslint/no-explicit-any
 										} as any),
 									});
-
-									if (!res.ok) {
-										throw await createApiError(res, {
-											requestId: batchRequestId,
-											message: `Error while uploading part ${part} of ${
-												operations[shas.indexOf(obj.oid)].path
-											} to LFS storage`,
-										});
+									// Client errors would fail again, only server errors and rate limits are retried
+									if (res.ok || (res.status < 500 && res.status !== 429) || attempt >= MULTIPART_PART_ATTEMPTS) {
+										break;
 									}
-
-									const eTag = res.headers.get("ETag");
-
-									if (!eTag) {
-										throw new Error("Cannot get ETag of part during multipart upload");
+								} catch (err) {
+									// Network error
+									if (abortSignal.aborted || attempt >= MULTIPART_PART_ATTEMPTS) {
+										throw err;
 									}
+								}
 
-									completeReq.parts[Number(part) - 1].etag = eTag;
-								}),
-								MULTIPART_PARALLEL_UPLOAD
-							);
-
-							abortSignal?.throwIfAborted();
-
-							const res = await (params.fetch ?? fetch)(completionUrl, {
-								method: "POST",
-								body: JSON.stringify(completeReq),
-								headers: {
-									Accept: "application/vnd.git-lfs+json",
-									"Content-Type": "application/vnd.git-lfs+json",
-								},
-								signal: abortSignal,
-							});
+								// Only this part is uploaded again, the others are not affected
+								await new Promise((resolve) => setTimeout(resolve, attempt * MULTIPART_PART_RETRY_DELAY));
+								abortSignal.throwIfAborted();
+							}
 
 							if (!res.ok) {
 								throw await createApiError(res, {
 									requestId: batchRequestId,
-									message: `Error completing multipart upload of ${
-										operations[shas.indexOf(obj.oid)].path
-									} to LFS storage`,
+									message: `Error while uploading part ${part} of ${op.path} to LFS storage`,
 								});
 							}
 
-							yieldCallback({
-								event: "fileProgress",
-								path: op.path,
-								progress: 1,
-								state: "uploading",
-							});
-						} else {
-							const res = await (params.fetch ?? fetch)(obj.actions.upload.href, {
-								method: "PUT",
-								headers: {
-									...(batchRequestId ? { "X-Request-Id": batchRequestId } : undefined),
-								},
-								/** Unfortunately, browsers don't support our inherited version of Blob in fetch calls */
-								body: content instanceof WebBlob && isFrontend ? await content.arrayBuffer() : content,
-								signal: abortSignal,
-								...({
-									progressHint: {
-										path: op.path,
-										progressCallback: (progress: number) =>
-											yieldCallback({
-												event: "fileProgress",
-												path: op.path,
-												progress,
-												state: "uploading",
-											}),
-									},
-									// eslint-disable-next-line @typescript-eslint/no-explicit-any
-								} as any),
-							});
+							const eTag = res.headers.get("ETag");
 
-							if (!res.ok) {
-								throw await createApiError(res, {
-									requestId: batchRequestId,
-									message: `Error while uploading ${operations[shas.indexOf(obj.oid)].path} to LFS storage`,
-								});
+							if (!eTag) {
+								throw new Error("Cannot get ETag of part during multipart upload");
 							}
 
-							yieldCallback({
-								event: "fileProgress",
+							completeReq.parts[Number(part) - 1].etag = eTag;
+						}),
+						MULTIPART_PARALLEL_UPLOAD
+					);
+
+					abortSignal?.throwIfAborted();
+
+					const res = await (params.fetch ?? fetch)(completionUrl, {
+						method: "POST",
+						body: JSON.stringify(completeReq),
+						headers: {
+							Accept: "application/vnd.git-lfs+json",
+							"Content-Type": "application/vnd.git-lfs+json",
+						},
+						signal: abortSignal,
+					});
+
+					if (!res.ok) {
+						throw await createApiError(res, {
+							requestId: batchRequestId,
+							message: `Error completing multipart upload of ${op.path} to LFS storage`,
+						});
+					}
+
+					yieldCallback({
+						event: "fileProgress",
+						path: op.path,
+						progress: 1,
+						state: "uploading",
+					});
+				} else {
+					const res = await (params.fetch ?? fetch)(obj.actions.upload.href, {
+						method: "PUT",
+						headers: {
+							...(batchRequestId ? { "X-Request-Id": batchRequestId } : undefined),
+						},
+						/** Unfortunately, browsers don't support our inherited version of Blob in fetch calls */
+						body: content instanceof WebBlob && isFrontend ? await content.arrayBuffer() : content,
+						signal: abortSignal,
+						...({
+							progressHint: {
 								path: op.path,
-								progress: 1,
-								state: "uploading",
-							});
-						}
+								progressCallback: (progress: number) =>
+									yieldCallback({
+										event: "fileProgress",
+										path: op.path,
+										progress,
+										state: "uploading",
+									}),
+							},
+							// eslint-disable-next-line @typescript-eslint/no-explicit-any
+						} as any),
+					});
+
+					if (!res.ok) {
+						throw await createApiError(res, {
+							requestId: batchRequestId,
+							message: `Error while uploading ${op.path} to LFS storage`,
+						});
+					}
+
+					yieldCallback({
+						event: "fileProgress",
+						path: op.path,
+						progress: 1,
+						state: "uploading",
+					});
+				}
+			};
+
+			const requestLfsBatch = async (operations: CommitBlob[]) => {
+				abortSignal?.throwIfAborted();
+
+				const payload: ApiLfsBatchRequest = {
+					operation: "upload",
+					// multipart is a custom protocol for HF
+					transfers: ["basic", "multipart"],
+					hash_algo: "sha_256",
+					...(!params.isPullRequest && {
+						ref: {
+							name: params.branch ?? "main",
+						},
 					}),
-					CONCURRENT_LFS_UPLOADS
-				).then(returnCallback, rejectCallback);
-			});
-		}
+					objects: operations.map((op) => ({
+						oid: lfsShas.get(op.path) as string,
+						size: op.content.size,
+					})),
+				};
+
+				const res = await (params.fetch ?? fetch)(
+					`${params.hubUrl ?? HUB_URL}/${repoId.type === "model" ? "" : repoId.type + "s/"}${
+						repoId.name
+					}.git/info/lfs/objects/batch`,
+					{
+						method: "POST",
+						headers: {
+							...(params.credentials && { Authorization: `Bearer ${params.credentials.accessToken}` }),
+							Accept: "application/vnd.git-lfs+json",
+							"Content-Type": "application/vnd.git-lfs+json",
+						},
+						body: JSON.stringify(payload),
+						signal: abortSignal,
+					}
+				);
+
+				if (!res.ok) {
+					throw await createApiError(res);
+				}
+
+				const json: ApiLfsBatchResponse = await res.json();
+				const batchRequestId = res.headers.get("X-Request-Id") || undefined;
+
+				const shaToOperation = new Map(operations.map((op) => [lfsShas.get(op.path), op]));
+
+				for (const obj of json.objects) {
+					const op = shaToOperation.get(obj.oid);
+
+					if (!op) {
+						throw new InvalidApiResponseFormatError("Unrequested object ID in response");
+					}
+
+					uploads.push(() => uploadLfsObject(op, obj, res.url, batchRequestId));
+				}
+			};
+
+			const sendBatch = () => {
+				clearTimeout(batchTimer);
+				batchTimer = undefined;
+				if (!hashedOperations.length) {
+					return;
+				}
+				const operations = hashedOperations;
+				hashedOperations = [];
+				batchRequests.push(requestLfsBatch(operations).catch(rejectCallback));
+			};
+
+			const onHashed = (op: CommitBlob, sha: string) => {
+				lfsShas.set(op.path, sha);
+				if (hashCache && !cachedShas.has(op.path)) {
+					// The cache is only an optimization, failing to update it doesn't fail the commit
+					cacheWrites.push(Promise.resolve(hashCache.cache.set(op.content, sha)).catch(() => {}));
+				}
+				hashedOperations.push(op);
+				if (hashedOperations.length >= LFS_BATCH_MAX_FILES) {
+					sendBatch();
+				} else {
+					batchTimer ??= setTimeout(sendBatch, LFS_BATCH_DELAY);
+				}
+			};
+
+			const hashBatched = async () => {
+				for (const operations of chunk(batchedOperations, LFS_BATCH_MAX_FILES)) {
+					for (const op of operations) {
+						yieldCallback({ event: "fileProgress", path: op.path, progress: 0, state: "hashing" });
+					}
+					const smallShas = await sha256Batch(operations.map((op) => op.content), { abortSignal });
+					for (const [i, op] of operations.entries()) {
+						yieldCallback({ event: "fileProgress", path: op.path, progress: 1, state: "hashing" });
+						onHashed(op, smallShas[i]);
+					}
+				}
+			};
+
+			const hashInWorkers = async () => {
+				if (!workerOperations.length) {
+					return;
+				}
+				// Send the files to the workers by batches rather than one message per file
+				const iterator = sha256Files(
+					workerOperations.map((op) => op.content),
+					{ useWebWorker: useWebWorkers, abortSignal }
+				);
+				let res: IteratorResult<{ index: number; progress: number; sha256?: string }, string[]>;
+				do {
+					res = await iterator.next();
+					if (!res.done) {
+						const op = workerOperations[res.value.index];
+						yieldCallback({ event: "fileProgress", path: op.path, progress: res.value.progress, state: "hashing" });
+						if (res.value.sha256) {
+							onHashed(op, res.value.sha256);
+						}
+					}
+				} while (!res.done);
+			};
+
+			const hashQueued = async (op: CommitBlob) => {
+				const task = hashTasks.get(op.path) as HashTask;
+				const onProgress = (progress: number) =>
+					yieldCallback({ event: "fileProgress", path: op.path, progress, state: "hashing" });
+				// Maybe started during the preupload calls
+				onProgress(task.progress);
+				task.onProgress = onProgress;
+				onHashed(op, (await task.sha) as string);
+			};
+
+			const hashAll = async () => {
+				for (const op of lfsOperations) {
+					const sha = cachedShas.get(op.path);
+					if (sha) {
+						yieldCallback({ event: "fileProgress", path: op.path, progress: 1, state: "hashing" });
+						onHashed(op, sha);
+					}
+				}
+
+				await Promise.all([
+					hashBatched(),
+					hashInWorkers(),
+					...lfsOperations.filter((op) => hashTasks.has(op.path)).map(hashQueued),
+				]);
+
+				sendBatch();
+				await Promise.all([...batchRequests, ...cacheWrites]);
+			};
+
+			return Promise.all([
+				hashAll().finally(() => uploads.close()),
+				promisesQueueStreaming(uploads, () => concurrency.uploadConcurrency),
+				hashing,
+			]).then(() => returnCallback(), rejectCallback);
+		});
 
 		abortSignal?.throwIfAborted();
 
@@ -546,8 +895,63 @@ export async function* commitIter(params: CommitParams): AsyncGenerator<CommitPr
 	} catch (err) {
 		// For parallel requests, cancel them all if one fails
 		abortController.abort();
+		hashQueue.close();
 		throw err;
+	} finally {
+		await closeHashCache?.();
+	}
+}
+
+/**
+ * Run a sha256 computation to its end, ignoring the progress
+ */
+async function drainSha256(iterator: AsyncGenerator<number, string>): Promise<string> {
+	let res: IteratorResult<number, string>;
+	do {
+		res = await iterator.next();
+	} while (!res.done);
+	return res.value;
+}
+
+/**
+ * sha256 of a blob and of each of its parts of `partSize` bytes, from a single read
+ */
+async function* sha256WithParts(
+	blob: Blob,
+	partSize: number,
+	abortSignal: AbortSignal,
+	onParts: (shas: string[]) => void
+): AsyncGenerator<number, string> {
+	const digests = yield* multiDigest(blob, { partSize, abortSignal });
+	onParts(digests.partSha256 ?? []);
+	return digests.sha256;
+}
+
+/**
+ * @returns the cache, and how to close it if it was opened here
+ */
+async function openHashCache(
+	hashCache: CommitParams["hashCache"]
+): Promise<{ cache: SHA256Cache; close?: () => Promise<void> } | undefined> {
+	if (!hashCache) {
+		return undefined;
+	}
+	if (typeof hashCache !== "string" && "get" in hashCache) {
+		return { cache: hashCache };
+	}
+
+	const { path, fingerprint } = typeof hashCache === "string" ? { path: hashCache, fingerprint: false } : hashCache;
+	if (isFrontend) {
+		if (typeof indexedDB === "undefined") {
+			throw new TypeError("hashCache requires IndexedDB in the browser, pass a SHA256Cache instead");
+		}
+		const { SHA256IndexedDBCache } = await import("../utils/sha256-cache-indexeddb");
+		const cache = await SHA256IndexedDBCache.open(path, { checksum: fingerprint });
+		return { cache, close: async () => cache.close() };
 	}
+	const { SHA256FileCache } = await import("../utils/sha256-cache-node");
+	const cache = await SHA256FileCache.open(path, { fingerprint });
+	return { cache, close: () => cache.close() };
 }
 
 export async function commit(params: CommitParams): Promise<CommitOutput> {
@@ -57,6 +57,10 @@ export async function* listFiles(params: {
 	 * Custom fetch function to use instead of the default one, for example to use a proxy or edit headers.
 	 */
 	fetch?: typeof fetch;
+	/**
+	 * Stops listing the files, the request in progress rejects with the reason of the signal
+	 */
+	abortSignal?: AbortSignal;
 }): AsyncGenerator<ListFileEntry> {
 	checkCredentials(params.credentials);
 	const repoId = toRepoId(params.repo);
@@ -70,6 +74,7 @@ export async function* listFiles(params: {
 				accept: "application/json",
 				...(params.credentials ? { Authorization: `Bearer ${params.credentials.accessToken}` } : undefined),
 			},
+			signal: params.abortSignal,
 		});
 
 		if (!res.ok) {
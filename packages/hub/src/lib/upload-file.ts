@@ -14,6 +14,9 @@ export function uploadFile(params: {
 	parentCommit?: CommitParams["parentCommit"];
 	fetch?: CommitParams["fetch"];
 	useWebWorkers?: CommitParams["useWebWorkers"];
+	hashCache?: CommitParams["hashCache"];
+	skipUnchanged?: CommitParams["skipUnchanged"];
+	partChecksums?: CommitParams["partChecksums"];
 	abortSignal?: CommitParams["abortSignal"];
 }): Promise<CommitOutput> {
 	const path =
@@ -41,6 +44,9 @@ export function uploadFile(params: {
 		parentCommit: params.parentCommit,
 		fetch: params.fetch,
 		useWebWorkers: params.useWebWorkers,
+		hashCache: params.hashCache,
+		skipUnchanged: params.skipUnchanged,
+		partChecksums: params.partChecksums,
 		abortSignal: params.abortSignal,
 	});
 }
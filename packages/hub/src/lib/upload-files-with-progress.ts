@@ -31,6 +31,9 @@ export async function* uploadFilesWithProgress(params: {
 	 * Set this to true in order to have progress events for hashing
 	 */
 	useWebWorkers?: CommitParams["useWebWorkers"];
+	hashCache?: CommitParams["hashCache"];
+	skipUnchanged?: CommitParams["skipUnchanged"];
+	partChecksums?: CommitParams["partChecksums"];
 }): AsyncGenerator<CommitProgressEvent, CommitOutput> {
 	return yield* commitIter({
 		credentials: params.credentials,
@@ -47,6 +50,9 @@ export async function* uploadFilesWithProgress(params: {
 		isPullRequest: params.isPullRequest,
 		parentCommit: params.parentCommit,
 		useWebWorkers: params.useWebWorkers,
+		hashCache: params.hashCache,
+		skipUnchanged: params.skipUnchanged,
+		partChecksums: params.partChecksums,
 		abortSignal: params.abortSignal,
 		fetch: async (input, init) => {
 			if (!init) {
@@ -13,6 +13,9 @@ export function uploadFiles(params: {
 	parentCommit?: CommitParams["parentCommit"];
 	fetch?: CommitParams["fetch"];
 	useWebWorkers?: CommitParams["useWebWorkers"];
+	hashCache?: CommitParams["hashCache"];
+	skipUnchanged?: CommitParams["skipUnchanged"];
+	partChecksums?: CommitParams["partChecksums"];
 	abortSignal?: CommitParams["abortSignal"];
 }): Promise<CommitOutput> {
 	return commit({
@@ -31,6 +34,9 @@ export function uploadFiles(params: {
 		parentCommit: params.parentCommit,
 		fetch: params.fetch,
 		useWebWorkers: params.useWebWorkers,
+		hashCache: params.hashCache,
+		skipUnchanged: params.skipUnchanged,
+		partChecksums: params.partChecksums,
 		abortSignal: params.abortSignal,
 	});
 }
@@ -0,0 +1,58 @@
+import { describe, expect, it } from "vitest";
+import { AdaptiveConcurrency } from "./AdaptiveConcurrency";
+import type { HashingStream } from "./AdaptiveConcurrency";
+
+/**
+ * Hash with as many streams as allowed for `duration` ms, each stream getting `throughput(streams)` bytes per ms
+ */
+function simulate(concurrency: AdaptiveConcurrency, clock: { now: number }, throughput: (streams: number) => number) {
+	const streams: Array<{ stream: HashingStream; bytesDone: number }> = [];
+	for (let tick = 0; tick < 200; tick++) {
+		while (streams.length < concurrency.hashConcurrency) {
+			streams.push({ stream: concurrency.hashStarted(), bytesDone: 0 });
+		}
+		clock.now += 100;
+		const rate = throughput(streams.length);
+		for (const entry of streams) {
+			entry.bytesDone += rate * 100;
+			entry.stream.progress(entry.bytesDone);
+		}
+	}
+	return streams;
+}
+
+describe("AdaptiveConcurrency", () => {
+	it("should use all the cores when hashing is CPU-bound", () => {
+		const clock = { now: 0 };
+		const concurrency = new AdaptiveConcurrency({ cores: 8, now: () => clock.now });
+		expect(concurrency.hashConcurrency).toBe(2);
+
+		simulate(concurrency, clock, () => 200_000);
+
+		expect(concurrency.hashConcurrency).toBe(8);
+	});
+
+	it("should stop adding streams when reading is the bottleneck", () => {
+		const clock = { now: 0 };
+		const concurrency = new AdaptiveConcurrency({ cores: 64, now: () => clock.now });
+
+		// The disk reads 400MB/s at most, shared by all the streams
+		simulate(concurrency, clock, (streams) => Math.min(200_000, 400_000 / streams));
+
+		expect(concurrency.hashConcurrency).toBe(2);
+	});
+
+	it("should give the slots not used by hashing to uploads", () => {
+		const clock = { now: 0 };
+		const concurrency = new AdaptiveConcurrency({ cores: 12, now: () => clock.now });
+		expect(concurrency.uploadConcurrency).toBe(12);
+
+		const streams = [concurrency.hashStarted(), concurrency.hashStarted()];
+		expect(concurrency.uploadConcurrency).toBe(10);
+
+		for (const stream of streams) {
+			stream.end();
+		}
+		expect(concurrency.uploadConcurrency).toBe(12);
+	});
+});
@@ -0,0 +1,127 @@
+/** Throughput is measured over windows of at least this duration, in ms... */
+const WINDOW_MIN_DURATION = 500;
+/** ...and at least this many bytes */
+const WINDOW_MIN_BYTES = 16_000_000;
+/** Relative change of throughput below which two measurements are considered equal */
+const THROUGHPUT_TOLERANCE = 0.1;
+const INITIAL_HASHING = 2;
+const MIN_UPLOADS = 2;
+const MAX_UPLOADS = 16;
+/** Uploads and hashes share this many slots, at least */
+const MIN_BUDGET = 8;
+
+export interface HashingStream {
+	/** Total number of bytes hashed by this stream so far */
+	progress(bytesDone: number): void;
+	end(): void;
+}
+
+/**
+ * Splits concurrency between hashing and uploading during a commit, based on the number of cores and on the
+ * throughput measured while hashing.
+ *
+ * Hashing starts with a couple of streams, and gets one more after each measurement window as long as the
+ * throughput of each stream stays close to the best one seen: streams don't slow each other down, so the cores
+ * are the limit. If adding a stream doesn't increase the total (read) throughput, reading is the bottleneck,
+ * for example a laptop disk, and the stream is removed for the rest of the commit.
+ *
+ * Uploads get the slots of the budget not used by hashing.
+ */
+export class AdaptiveConcurrency {
+	/** Upper bound of the hashing concurrency, the number of cores */
+	readonly maxHashing: number;
+	private readonly budget: number;
+	private readonly now: () => number;
+
+	private hashing: number;
+	/** Hashing concurrency is not increased above this anymore */
+	private ceiling: number;
+	private readonly streams = new Set<{ active: number }>();
+
+	private windowStart: number;
+	private windowBytes = 0;
+	/** Sum of the durations of the streams during the window */
+	private windowStreamDuration = 0;
+	private lastAggregate: number | undefined;
+	/** Whether the last measurement added a stream */
+	private increased = false;
+	private bestPerStream = 0;
+
+	constructor(opts: { cores: number; now?: () => number }) {
+		this.maxHashing = Math.max(1, opts.cores);
+		this.budget = Math.max(MIN_BUDGET, this.maxHashing);
+		this.now = opts.now ?? (() => performance.now());
+		this.hashing = Math.min(INITIAL_HASHING, this.maxHashing);
+		this.ceiling = this.maxHashing;
+		this.windowStart = this.now();
+	}
+
+	/** How many files to hash at the same time */
+	get hashConcurrency(): number {
+		return this.hashing;
+	}
+
+	/** How many files to upload at the same time */
+	get uploadConcurrency(): number {
+		return Math.min(MAX_UPLOADS, Math.max(MIN_UPLOADS, this.budget - this.streams.size));
+	}
+
+	hashStarted(): HashingStream {
+		const stream = { active: this.now() };
+		let lastBytesDone = 0;
+		this.streams.add(stream);
+		return {
+			progress: (bytesDone: number) => {
+				if (!this.streams.has(stream)) {
+					return;
+				}
+				const now = this.now();
+				this.windowBytes += bytesDone - lastBytesDone;
+				this.windowStreamDuration += now - stream.active;
+				lastBytesDone = bytesDone;
+				stream.active = now;
+				this.measure(now);
+			},
+			end: () => {
+				this.streams.delete(stream);
+			},
+		};
+	}
+
+	private measure(now: number): void {
+		const duration = now - this.windowStart;
+		if (duration < WINDOW_MIN_DURATION || this.windowBytes < WINDOW_MIN_BYTES || !this.windowStreamDuration) {
+			return;
+		}
+
+		const aggregate = this.windowBytes / duration;
+		const perStream = this.windowBytes / this.windowStreamDuration;
+		this.windowStart = now;
+		this.windowBytes = 0;
+		this.windowStreamDuration = 0;
+
+		if (this.streams.size < this.hashing) {
+			// Fewer files than slots, or the last slot added is not used yet: nothing to learn about the concurrency
+			return;
+		}
+
+		this.bestPerStream = Math.max(this.bestPerStream, perStream);
+		if (
+			this.increased &&
+			this.lastAggregate !== undefined &&
+			aggregate < this.lastAggregate * (1 + THROUGHPUT_TOLERANCE)
+		) {
+			// The last stream added brought nothing
+			this.hashing = Math.max(1, this.hashing - 1);
+			this.ceiling = this.hashing;
+			this.increased = false;
+		} else if (this.hashing < this.ceiling && perStream >= this.bestPerStream * (1 - THROUGHPUT_TOLERANCE)) {
+			this.hashing++;
+			this.increased = true;
+		} else {
+			this.increased = false;
+		}
+
+		this.lastAggregate = aggregate;
+	}
+}
@@ -35,9 +35,12 @@ export class FileBlob extends Blob {
 		return fileBlob;
 	}
 
-	private path: string;
-	private start: number;
-	private end: number;
+	/** Path of the underlying file */
+	readonly path: string;
+	/** Offset of the blob in the file */
+	readonly start: number;
+	/** Offset of the end of the blob in the file, exclusive */
+	readonly end: number;
 
 	private constructor(path: string, start: number, end: number) {
 		super();
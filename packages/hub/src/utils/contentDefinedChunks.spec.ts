@@ -0,0 +1,72 @@
+import { describe, expect, it } from "vitest";
+import { contentDefinedChunks } from "./contentDefinedChunks";
+import type { ContentDefinedChunk } from "./contentDefinedChunks";
+import { sha256 } from "./sha256";
+
+async function collect(blob: Blob): Promise<ContentDefinedChunk[]> {
+	const chunks: ContentDefinedChunk[] = [];
+	for await (const chunk of contentDefinedChunks(blob, { avgSize: 4096 })) {
+		chunks.push(chunk);
+	}
+	return chunks;
+}
+
+function randomBytes(size: number, seed: number): Uint8Array {
+	const bytes = new Uint8Array(size);
+	for (let i = 0; i < size; i++) {
+		seed = (Math.imul(seed, 1103515245) + 12345) >>> 0;
+		bytes[i] = seed >>> 24;
+	}
+	return bytes;
+}
+
+describe("contentDefinedChunks", () => {
+	it("should cover the blob with contiguous chunks", async () => {
+		const blob = new Blob([randomBytes(200_000, 1)]);
+
+		const chunks = await collect(blob);
+
+		expect(chunks.length).toBeGreaterThan(10);
+		let offset = 0;
+		for (const chunk of chunks) {
+			expect(chunk.offset).toBe(offset);
+			expect(chunk.length).toBeLessThanOrEqual(4 * 4096);
+			offset += chunk.length;
+		}
+		expect(offset).toBe(blob.size);
+
+		const iterator = sha256(blob.slice(chunks[3].offset, chunks[3].offset + chunks[3].length));
+		let res: IteratorResult<number, string>;
+		do {
+			res = await iterator.next();
+		} while (!res.done);
+		expect(chunks[3].sha256).toBe(res.value);
+	});
+
+	it("should cut fixed-size chunks when all the sizes are equal, across updates", async () => {
+		const content = randomBytes(100_000, 3);
+		// Parts not aligned on the chunk size, so that chunks span several updates
+		const parts = [content.subarray(0, 1000), content.subarray(1000, 50_001), content.subarray(50_001)];
+
+		const chunks: ContentDefinedChunk[] = [];
+		for await (const chunk of contentDefinedChunks(new Blob(parts), { minSize: 64, avgSize: 64, maxSize: 64 })) {
+			chunks.push(chunk);
+		}
+
+		expect(chunks.length).toBe(Math.ceil(content.length / 64));
+		expect(chunks.every((chunk, i) => chunk.offset === i * 64)).toBe(true);
+		expect(chunks.at(-1)?.length).toBe(content.length % 64);
+	});
+
+	it("should only change the chunks around a modification", async () => {
+		const content = randomBytes(200_000, 2);
+		const modified = new Uint8Array([...content.subarray(0, 100_000), 1, 2, 3, ...content.subarray(100_000)]);
+
+		const before = new Set((await collect(new Blob([content]))).map((chunk) => chunk.sha256));
+		const after = await collect(new Blob([modified]));
+
+		const changed = after.filter((chunk) => !before.has(chunk.sha256));
+		expect(changed.length).toBeGreaterThan(0);
+		expect(changed.length).toBeLessThanOrEqual(2);
+	});
+});
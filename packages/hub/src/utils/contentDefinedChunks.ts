@@ -0,0 +1,74 @@
+export interface ContentDefinedChunk {
+	/** Position of the chunk in the blob */
+	offset: number;
+	length: number;
+	/** Hex-encoded sha256 of the chunk */
+	sha256: string;
+}
+
+/**
+ * Split a blob into content-defined chunks (FastCDC), as it is read.
+ *
+ * Boundaries only depend on the content around them: when a file is modified, only the chunks around the
+ * modifications change, and the others can be deduplicated by their sha256.
+ *
+ * The chunks are contiguous and cover the whole blob.
+ */
+export async function* contentDefinedChunks(
+	buffer: Blob,
+	opts?: {
+		/**
+		 * Minimum chunk size, at least 64 bytes, except for the last chunk
+		 *
+		 * @default avgSize / 4
+		 */
+		minSize?: number;
+		/**
+		 * Targeted average chunk size
+		 *
+		 * @default 64 * 1024
+		 */
+		avgSize?: number;
+		/**
+		 * Maximum chunk size, at most 64 MiB
+		 *
+		 * @default avgSize * 4
+		 */
+		maxSize?: number;
+		abortSignal?: AbortSignal;
+	}
+): AsyncGenerator<ContentDefinedChunk> {
+	const avgSize = opts?.avgSize ?? 64 * 1024;
+	const { createContentDefinedChunker } = await import("../vendor/hash-wasm/sha256-wrapper");
+	const chunker = await createContentDefinedChunker({
+		minSize: opts?.minSize ?? Math.floor(avgSize / 4),
+		avgSize,
+		maxSize: opts?.maxSize ?? avgSize * 4,
+		sizeHint: buffer.size,
+	});
+	const reader = buffer.stream().getReader();
+	let offset = 0;
+
+	try {
+		while (true) {
+			const { done, value } = await reader.read();
+			const chunks = done ? chunker.final() : chunker.update(value);
+
+			for (const chunk of chunks) {
+				yield { offset, ...chunk };
+				offset += chunk.length;
+			}
+
+			if (done) {
+				return;
+			}
+
+			opts?.abortSignal?.throwIfAborted();
+		}
+	} catch (err) {
+		await reader.cancel().catch(() => {});
+		throw err;
+	} finally {
+		chunker.destroy();
+	}
+}
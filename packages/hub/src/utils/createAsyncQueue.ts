@@ -0,0 +1,35 @@
+/**
+ * Async iterable fed with `push` and ended with `close`, to consume items while they're produced,
+ * for example with promisesQueueStreaming.
+ */
+export function createAsyncQueue<T>(): AsyncIterable<T> & { push(item: T): void; close(): void } {
+	const items: T[] = [];
+	let closed = false;
+	let wake: (() => void) | undefined;
+
+	return {
+		push(item: T) {
+			items.push(item);
+			wake?.();
+		},
+		close() {
+			closed = true;
+			wake?.();
+		},
+		async *[Symbol.asyncIterator]() {
+			while (true) {
+				if (items.length) {
+					yield items.shift() as T;
+					continue;
+				}
+				if (closed) {
+					return;
+				}
+				await new Promise<void>((resolve) => {
+					wake = resolve;
+				});
+				wake = undefined;
+			}
+		},
+	};
+}
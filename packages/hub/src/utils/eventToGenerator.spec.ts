@@ -41,4 +41,32 @@ describe("eventToGenerator", () => {
 		expect(results).toEqual([1, 2]);
 		expect(res.value).toBe(3);
 	});
+
+	it("should reject after the events emitted before the error", async () => {
+		const it = eventToGenerator<number, number>((yieldCallback, returnCallback, rejectCallback) => {
+			yieldCallback(1);
+			yieldCallback(2);
+			setTimeout(() => rejectCallback(new Error("failed")), 100);
+		});
+
+		expect(await it.next()).toEqual({ done: false, value: 1 });
+		expect(await it.next()).toEqual({ done: false, value: 2 });
+		await expect(it.next()).rejects.toThrow("failed");
+	});
+
+	it("should reject even when events are not consumed yet", async () => {
+		const it = eventToGenerator<number, number>((yieldCallback, returnCallback, rejectCallback) => {
+			yieldCallback(1);
+			yieldCallback(2);
+			rejectCallback(new Error("failed"));
+		});
+
+		const results = [];
+		await expect(async () => {
+			for (let res = await it.next(); !res.done; res = await it.next()) {
+				results.push(res.value);
+			}
+		}).rejects.toThrow("failed");
+		expect(results).toEqual([1, 2]);
+	});
 });
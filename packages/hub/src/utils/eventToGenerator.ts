@@ -18,6 +18,8 @@ export async function* eventToGenerator<YieldType, ReturnType>(
 			resolve = res;
 			reject = rej;
 		});
+		// Rejections are only observed once the events before them are consumed
+		p.catch(() => {});
 		// @ts-expect-error TS doesn't know that promise callback is executed immediately
 		promises.push({ p, resolve, reject });
 	}
@@ -35,10 +37,11 @@ export async function* eventToGenerator<YieldType, ReturnType>(
 					addPromise();
 					promises.at(-2)?.resolve({ done: true, value: r });
 				},
-				(err) => promises.shift()?.reject(err)
+				// The last promise is the only pending one, the others hold events not consumed yet
+				(err) => promises.at(-1)?.reject(err)
 			)
 		)
-		.catch((err) => promises.shift()?.reject(err));
+		.catch((err) => promises.at(-1)?.reject(err));
 
 	while (1) {
 		const p = promises[0];
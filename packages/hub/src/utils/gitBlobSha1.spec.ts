@@ -0,0 +1,10 @@
+import { describe, expect, it } from "vitest";
+import { gitBlobSha1 } from "./gitBlobSha1";
+
+describe("gitBlobSha1", () => {
+	it("should compute the git object id of a blob", async () => {
+		// git hash-object
+		expect(await gitBlobSha1(new Blob(["hello world\n"]))).toBe("3b18e512dba79e4c8300dd08aeb37f8e728b8dad");
+		expect(await gitBlobSha1(new Blob([]))).toBe("e69de29bb2d1d6434b8b29ae775ad8c2e48c5391");
+	});
+});
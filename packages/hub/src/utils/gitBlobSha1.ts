@@ -0,0 +1,40 @@
+import { isFrontend } from "./isFrontend";
+
+/**
+ * Git object id of a file, `sha1("blob <size>\0" + content)`, as in the `oid` of `listFiles` entries
+ *
+ * @returns hex-encoded sha1
+ */
+export async function gitBlobSha1(buffer: Blob, opts?: { abortSignal?: AbortSignal }): Promise<string> {
+	const reader = buffer.stream().getReader();
+
+	if (!isFrontend) {
+		const { createHash } = await import("node:crypto");
+		const sha1 = createHash("sha1");
+		sha1.update(`blob ${buffer.size}\0`);
+		while (true) {
+			const { done, value } = await reader.read();
+			if (done) {
+				return sha1.digest("hex");
+			}
+			sha1.update(value);
+			opts?.abortSignal?.throwIfAborted();
+		}
+	}
+
+	const { createSHA1 } = await import("../vendor/hash-wasm/sha256-wrapper");
+	const sha1 = await createSHA1({ sizeHint: buffer.size });
+	sha1.initGitBlob(buffer.size);
+	try {
+		while (true) {
+			const { done, value } = await reader.read();
+			if (done) {
+				return sha1.digest("hex");
+			}
+			sha1.update(value);
+			opts?.abortSignal?.throwIfAborted();
+		}
+	} finally {
+		sha1.destroy();
+	}
+}
@@ -0,0 +1,14 @@
+import { isFrontend } from "./isFrontend";
+
+/**
+ * Number of logical cores available to the page or the process
+ */
+export async function hardwareConcurrency(): Promise<number> {
+	if (isFrontend) {
+		return globalThis.navigator?.hardwareConcurrency || 4;
+	}
+
+	const os = await import("node:os");
+	// availableParallelism is not available before Node.js 18.14
+	return (typeof os.availableParallelism === "function" ? os.availableParallelism() : os.cpus().length) || 4;
+}
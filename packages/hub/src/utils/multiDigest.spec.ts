@@ -0,0 +1,37 @@
+import { describe, expect, it } from "vitest";
+import { multiDigest } from "./multiDigest";
+import { sha256 } from "./sha256";
+import { gitBlobSha1 } from "./gitBlobSha1";
+
+async function drain<T>(iterator: AsyncGenerator<unknown, T>): Promise<T> {
+	let res: IteratorResult<unknown, T>;
+	do {
+		res = await iterator.next();
+	} while (!res.done);
+	return res.value;
+}
+
+describe("multiDigest", () => {
+	it("should compute all the digests in one pass", async () => {
+		const content = new Blob(["O123456789".repeat(100_000)]);
+
+		const result = await drain(multiDigest(content, { gitBlobSha1: true, partSize: 300_000 }));
+
+		expect(result.sha256).toBe(await drain(sha256(content)));
+		expect(result.gitBlobSha1).toBe(await gitBlobSha1(content));
+		expect(result.partSha256).toEqual(
+			await Promise.all(
+				[0, 300_000, 600_000, 900_000].map((start) => drain(sha256(content.slice(start, start + 300_000))))
+			)
+		);
+	});
+
+	it("should only compute the requested digests", async () => {
+		const content = new Blob(["hello world"]);
+
+		expect(await drain(multiDigest(content))).toEqual({
+			sha256: "b94d27b9934d3e08a52e52d7da7dabfac484efe37a5380ee9088f7ace2efcde9",
+		});
+		expect((await drain(multiDigest(new Blob([]), { partSize: 10 }))).partSha256).toEqual([]);
+	});
+});
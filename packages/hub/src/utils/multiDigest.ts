@@ -0,0 +1,112 @@
+import { isFrontend } from "./isFrontend";
+
+export interface MultiDigest {
+	/** Hex-encoded sha256 of the whole blob */
+	sha256: string;
+	/** Git object id of the blob, with `gitBlobSha1` */
+	gitBlobSha1?: string;
+	/** Hex-encoded sha256 of each `partSize` bytes slice of the blob, with `partSize` */
+	partSha256?: string[];
+}
+
+/**
+ * Compute several digests of a blob while reading it only once, instead of once per digest
+ *
+ * @returns the digests
+ * @yields progress (0-1)
+ */
+export async function* multiDigest(
+	buffer: Blob,
+	opts?: {
+		/** Also compute the git object id */
+		gitBlobSha1?: boolean;
+		/** Also compute the sha256 of each slice of this size, for example the parts of a multipart upload */
+		partSize?: number;
+		abortSignal?: AbortSignal;
+	}
+): AsyncGenerator<number, MultiDigest> {
+	const partSize = opts?.partSize;
+	if (partSize !== undefined && !(partSize > 0)) {
+		throw new TypeError("partSize must be a positive number");
+	}
+
+	const hasher = isFrontend ? await createWasmHasher(buffer.size, opts) : await createNodeHasher(buffer.size, opts);
+	const reader = buffer.stream().getReader();
+	const total = buffer.size;
+	let bytesDone = 0;
+
+	try {
+		while (true) {
+			const { done, value } = await reader.read();
+			if (done) {
+				break;
+			}
+
+			hasher.update(value);
+			bytesDone += value.length;
+			yield total ? bytesDone / total : 1;
+
+			opts?.abortSignal?.throwIfAborted();
+		}
+
+		return hasher.digest();
+	} catch (err) {
+		await reader.cancel().catch(() => {});
+		throw err;
+	} finally {
+		hasher.destroy();
+	}
+}
+
+interface Hasher {
+	update(data: Uint8Array): void;
+	digest(): MultiDigest;
+	destroy(): void;
+}
+
+async function createWasmHasher(size: number, opts?: { gitBlobSha1?: boolean; partSize?: number }): Promise<Hasher> {
+	const { createMultiDigest } = await import("../vendor/hash-wasm/sha256-wrapper");
+	return createMultiDigest({ size, gitBlob: opts?.gitBlobSha1, partSize: opts?.partSize });
+}
+
+async function createNodeHasher(size: number, opts?: { gitBlobSha1?: boolean; partSize?: number }): Promise<Hasher> {
+	const { createHash } = await import("node:crypto");
+	const whole = createHash("sha256");
+	const sha1 = opts?.gitBlobSha1 ? createHash("sha1").update(`blob ${size}\0`) : undefined;
+	const partSize = opts?.partSize;
+	const partSha256: string[] = [];
+	let part = partSize ? createHash("sha256") : undefined;
+	let partRemaining = partSize ?? 0;
+
+	return {
+		update(data) {
+			whole.update(data);
+			sha1?.update(data);
+			if (!part || !partSize) {
+				return;
+			}
+			for (let offset = 0; offset < data.byteLength; ) {
+				const length = Math.min(partRemaining, data.byteLength - offset);
+				part.update(data.subarray(offset, offset + length));
+				partRemaining -= length;
+				offset += length;
+				if (!partRemaining) {
+					partSha256.push(part.digest("hex"));
+					part = createHash("sha256");
+					partRemaining = partSize;
+				}
+			}
+		},
+		digest() {
+			if (part && partRemaining !== partSize) {
+				partSha256.push(part.digest("hex"));
+			}
+			return {
+				sha256: whole.digest("hex"),
+				...(sha1 && { gitBlobSha1: sha1.digest("hex") }),
+				...(partSize !== undefined && { partSha256 }),
+			};
+		},
+		destroy() {},
+	};
+}
@@ -2,8 +2,15 @@
  * Execute queue of promises.
  *
  * Inspired by github.com/rxaviers/async-pool
+ *
+ * @param concurrency - can be a function, called each time a promise is about to start, to change the concurrency
+ * while the queue runs
  */
-export async function promisesQueue<T>(factories: (() => Promise<T>)[], concurrency: number): Promise<T[]> {
+export async function promisesQueue<T>(
+	factories: (() => Promise<T>)[],
+	concurrency: number | (() => number)
+): Promise<T[]> {
+	const limit = typeof concurrency === "function" ? concurrency : () => concurrency;
 	const results: T[] = [];
 	const executing: Set<Promise<void>> = new Set();
 	let index = 0;
@@ -14,7 +21,7 @@ export async function promisesQueue<T>(factories: (() => Promise<T>)[], concurre
 			executing.delete(e);
 		});
 		executing.add(e);
-		if (executing.size >= concurrency) {
+		while (executing.size >= Math.max(1, limit())) {
 			await Promise.race(executing);
 		}
 	}
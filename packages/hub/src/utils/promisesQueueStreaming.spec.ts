@@ -0,0 +1,27 @@
+import { describe, expect, it } from "vitest";
+import { promisesQueueStreaming } from "./promisesQueueStreaming";
+import { createAsyncQueue } from "./createAsyncQueue";
+
+describe("promisesQueueStreaming", () => {
+	it("should reject while waiting for the next factory", async () => {
+		const queue = createAsyncQueue<() => Promise<void>>();
+		queue.push(() => Promise.reject(new Error("error 1")));
+
+		// The queue is never closed
+		await expect(promisesQueueStreaming(queue, 10)).rejects.toThrow("error 1");
+	});
+
+	it("should not start the factories after a failure", async () => {
+		const started: number[] = [];
+		const factories = [1, 2, 3, 4].map((i) => async () => {
+			started.push(i);
+			await new Promise((resolve) => setTimeout(resolve, 10));
+			if (i === 1) {
+				throw new Error("error 1");
+			}
+		});
+
+		await expect(promisesQueueStreaming(factories, 1)).rejects.toThrow("error 1");
+		expect(started).toEqual([1]);
+	});
+});
@@ -6,20 +6,47 @@
  * - Does not return a list of all results
  *
  * Inspired by github.com/rxaviers/async-pool
+ *
+ * Rejects as soon as one of the promises rejects, even while waiting for the next factory of an async iterable,
+ * without starting the factories that come after.
+ *
+ * @param concurrency - can be a function, called each time a promise is about to start, to change the concurrency
+ * while the queue runs
  */
 export async function promisesQueueStreaming<T>(
 	factories: AsyncIterable<() => Promise<T>> | Iterable<() => Promise<T>>,
-	concurrency: number
+	concurrency: number | (() => number)
 ): Promise<void> {
+	const limit = typeof concurrency === "function" ? concurrency : () => concurrency;
 	const executing: Promise<void>[] = [];
-	for await (const factory of factories) {
-		const e = factory().then(() => {
-			executing.splice(executing.indexOf(e), 1);
-		});
-		executing.push(e);
-		if (executing.length >= concurrency) {
-			await Promise.race(executing);
+	let failed = false;
+	let fail: (err: unknown) => void = () => {};
+	const failure = new Promise<never>((_, reject) => {
+		fail = reject;
+	});
+
+	const run = async () => {
+		for await (const factory of factories) {
+			if (failed) {
+				return;
+			}
+			const e: Promise<void> = factory().then(
+				() => {
+					executing.splice(executing.indexOf(e), 1);
+				},
+				(err) => {
+					failed = true;
+					executing.splice(executing.indexOf(e), 1);
+					fail(err);
+				}
+			);
+			executing.push(e);
+			while (!failed && executing.length >= Math.max(1, limit())) {
+				await Promise.race(executing);
+			}
 		}
-	}
-	await Promise.all(executing);
+		await Promise.all(executing);
+	};
+
+	return Promise.race([run(), failure]);
 }
@@ -0,0 +1,55 @@
+import { describe, expect, it } from "vitest";
+import { SHA256IndexedDBCache } from "./sha256-cache-indexeddb";
+
+const SHA = "a".repeat(64);
+
+describe.skipIf(typeof indexedDB === "undefined")("SHA256IndexedDBCache", () => {
+	it("should persist the shas of files", async () => {
+		const name = `hub-sha256-cache-${Math.random()}`;
+		const file = new File(["hello world"], "file.txt", { lastModified: 1000 });
+
+		let cache = await SHA256IndexedDBCache.open(name);
+		expect(await cache.get(file)).toBeUndefined();
+		await cache.set(file, SHA);
+		expect(await cache.get(file)).toBe(SHA);
+		cache.close();
+
+		cache = await SHA256IndexedDBCache.open(name);
+		expect(await cache.get(new File(["hello world"], "file.txt", { lastModified: 1000 }))).toBe(SHA);
+		expect(await cache.get(new File(["hello world"], "file.txt", { lastModified: 2000 }))).toBeUndefined();
+		expect(await cache.get(new Blob(["hello world"]))).toBeUndefined();
+		cache.close();
+		indexedDB.deleteDatabase(name);
+	});
+
+	it("should tell apart files with the same name in different folders", async () => {
+		const name = `hub-sha256-cache-${Math.random()}`;
+		const inFolder = (folder: string) => {
+			const file = new File(["hello world"], "file.txt", { lastModified: 1000 });
+			Object.defineProperty(file, "webkitRelativePath", { value: `${folder}/file.txt` });
+			return file;
+		};
+
+		const cache = await SHA256IndexedDBCache.open(name);
+		const file = inFolder("a");
+		await cache.get(file);
+		await cache.set(file, SHA);
+		expect(await cache.get(inFolder("a"))).toBe(SHA);
+		expect(await cache.get(inFolder("b"))).toBeUndefined();
+		cache.close();
+		indexedDB.deleteDatabase(name);
+	});
+
+	it("should compare checksums", async () => {
+		const name = `hub-sha256-cache-${Math.random()}`;
+		const file = new File(["hello world"], "file.txt", { lastModified: 1000 });
+
+		const cache = await SHA256IndexedDBCache.open(name, { checksum: true });
+		await cache.get(file);
+		await cache.set(file, SHA);
+		expect(await cache.get(new File(["hello world"], "file.txt", { lastModified: 1000 }))).toBe(SHA);
+		expect(await cache.get(new File(["hello there"], "file.txt", { lastModified: 1000 }))).toBeUndefined();
+		cache.close();
+		indexedDB.deleteDatabase(name);
+	});
+});
@@ -0,0 +1,88 @@
+import type { SHA256Cache } from "./sha256";
+import { prefixCheck } from "./sha256";
+
+const STORE_NAME = "shas";
+
+interface Entry {
+	sha: string;
+	/** Empty if checksums are disabled */
+	checksum: string;
+}
+
+/**
+ * Persistent cache of the shas of `File` contents, for browsers.
+ *
+ * A sha is reused for a file with the same path, size and last modification time, for example when the same
+ * folder is added again or a failed commit is retried. With `checksum`, a few sampled ranges of the file are also
+ * hashed and compared.
+ *
+ * The path is `webkitRelativePath`, for files picked with a directory input. Other files only have their name, so
+ * files with the same name, size and modification time in different folders can only be told apart by `checksum`.
+ *
+ * Other blobs are never found in the cache.
+ */
+export class SHA256IndexedDBCache implements SHA256Cache {
+	/**
+	 * Open the IndexedDB database `name`, created if it doesn't exist
+	 */
+	static async open(name: string, opts?: { checksum?: boolean }): Promise<SHA256IndexedDBCache> {
+		const request = indexedDB.open(name, 1);
+		request.onupgradeneeded = () => {
+			request.result.createObjectStore(STORE_NAME);
+		};
+		return new SHA256IndexedDBCache(await promisifyRequest(request), opts?.checksum ?? false);
+	}
+
+	/** Checksums computed when the files were looked up, to not sample them again once hashed */
+	private readonly checksums = new WeakMap<Blob, string>();
+
+	private constructor(
+		private readonly db: IDBDatabase,
+		private readonly checksum: boolean
+	) {}
+
+	async get(blob: Blob): Promise<string | undefined> {
+		if (!(blob instanceof File)) {
+			return undefined;
+		}
+
+		const checksum = this.checksum ? await prefixCheck(blob, blob.size) : "";
+		this.checksums.set(blob, checksum);
+
+		const store = this.db.transaction(STORE_NAME, "readonly").objectStore(STORE_NAME);
+		const entry: Entry | undefined = await promisifyRequest(store.get(fileKey(blob)));
+		return entry && entry.checksum === checksum ? entry.sha : undefined;
+	}
+
+	/**
+	 * Only remembers files looked up with {@link get} before being hashed
+	 */
+	async set(blob: Blob, sha: string): Promise<void> {
+		const checksum = this.checksums.get(blob);
+		if (!(blob instanceof File) || checksum === undefined) {
+			return;
+		}
+
+		const transaction = this.db.transaction(STORE_NAME, "readwrite");
+		transaction.objectStore(STORE_NAME).put({ sha, checksum } satisfies Entry, fileKey(blob));
+		await new Promise<void>((resolve, reject) => {
+			transaction.oncomplete = () => resolve();
+			transaction.onerror = transaction.onabort = () => reject(transaction.error);
+		});
+	}
+
+	close(): void {
+		this.db.close();
+	}
+}
+
+function fileKey(file: File): IDBValidKey {
+	return [file.webkitRelativePath || file.name, file.size, file.lastModified];
+}
+
+function promisifyRequest<T>(request: IDBRequest<T>): Promise<T> {
+	return new Promise((resolve, reject) => {
+		request.onsuccess = () => resolve(request.result);
+		request.onerror = () => reject(request.error);
+	});
+}
@@ -0,0 +1,61 @@
+import { mkdtemp, rm, utimes, writeFile } from "node:fs/promises";
+import { tmpdir } from "node:os";
+import { join } from "node:path";
+import { afterEach, beforeEach, describe, expect, it } from "vitest";
+import { FileBlob } from "./FileBlob";
+import { SHA256FileCache } from "./sha256-cache-node";
+
+const SHA = "a".repeat(64);
+
+describe("SHA256FileCache", () => {
+	let dir: string;
+
+	beforeEach(async () => {
+		dir = await mkdtemp(join(tmpdir(), "hub-sha256-cache-"));
+		await writeFile(join(dir, "file.txt"), "hello world");
+	});
+
+	afterEach(async () => {
+		await rm(dir, { recursive: true, force: true });
+	});
+
+	it("should persist the shas of files", async () => {
+		let cache = await SHA256FileCache.open(join(dir, "cache"));
+		const blob = await FileBlob.create(join(dir, "file.txt"));
+
+		expect(await cache.get(blob)).toBeUndefined();
+		await cache.set(blob, SHA);
+		expect(await cache.get(blob)).toBe(SHA);
+		await cache.close();
+
+		cache = await SHA256FileCache.open(join(dir, "cache"));
+		expect(await cache.get(await FileBlob.create(join(dir, "file.txt")))).toBe(SHA);
+		expect(await cache.get(blob.slice(0, 5))).toBeUndefined();
+		expect(await cache.get(new Blob(["hello world"]))).toBeUndefined();
+		await cache.close();
+	});
+
+	it("should ignore modified files", async () => {
+		const cache = await SHA256FileCache.open(join(dir, "cache"), { fingerprint: true });
+		const blob = await FileBlob.create(join(dir, "file.txt"));
+
+		await cache.get(blob);
+		await cache.set(blob, SHA);
+		expect(await cache.get(blob)).toBe(SHA);
+
+		await utimes(join(dir, "file.txt"), new Date(), new Date(Date.now() + 10_000));
+		expect(await cache.get(blob)).toBeUndefined();
+		await cache.close();
+	});
+
+	it("should not remember files modified while hashing", async () => {
+		const cache = await SHA256FileCache.open(join(dir, "cache"));
+		const blob = await FileBlob.create(join(dir, "file.txt"));
+
+		await cache.get(blob);
+		await writeFile(join(dir, "file.txt"), "hello world, again");
+		await cache.set(blob, SHA);
+		expect(await cache.get(blob)).toBeUndefined();
+		await cache.close();
+	});
+});
@@ -0,0 +1,211 @@
+import { createHash } from "node:crypto";
+import { open, readFile, rename, stat, writeFile } from "node:fs/promises";
+import type { FileHandle } from "node:fs/promises";
+import { FileBlob } from "./FileBlob";
+import type { SHA256Cache } from "./sha256";
+
+const FINGERPRINT_SAMPLES = 8;
+const FINGERPRINT_SAMPLE_SIZE = 4096;
+/** The file is rewritten when it is opened, if it has this many times more lines than entries... */
+const COMPACTION_RATIO = 2;
+/** ...and at least this many lines */
+const COMPACTION_MIN_LINES = 1000;
+
+interface FileIdentity {
+	size: number;
+	mtimeMs: number;
+	ino: number;
+	dev: number;
+	/** Empty if fingerprints are disabled */
+	fingerprint: string;
+}
+
+interface Entry extends FileIdentity {
+	sha: string;
+}
+
+/**
+ * Persistent cache of the shas of FileBlob contents, for Node.js.
+ *
+ * A sha is reused as long as the file has the same path, size, modification time, inode and device. With
+ * `fingerprint`, a few sampled ranges of the blob are also hashed and compared, to catch modifications that
+ * keep the modification time.
+ *
+ * Entries are appended to a text file, one per line, the last line of a blob wins:
+ *
+ * `sha size mtimeMs ino dev fingerprint start end "path"`, separated by tabs
+ *
+ * Other blobs are never found in the cache.
+ */
+export class SHA256FileCache implements SHA256Cache {
+	/**
+	 * Load the cache from `path`, created if it doesn't exist
+	 */
+	static async open(path: string, opts?: { fingerprint?: boolean }): Promise<SHA256FileCache> {
+		let content = "";
+		try {
+			content = await readFile(path, "utf8");
+		} catch (err) {
+			if ((err as NodeJS.ErrnoException).code !== "ENOENT") {
+				throw err;
+			}
+		}
+
+		const entries = new Map<string, Entry>();
+		const lines = content.split("\n").filter(Boolean);
+		for (const line of lines) {
+			const parsed = parseLine(line);
+			if (parsed) {
+				entries.set(parsed.key, parsed.entry);
+			}
+		}
+
+		if (lines.length >= COMPACTION_MIN_LINES && lines.length > entries.size * COMPACTION_RATIO) {
+			const tmpPath = `${path}.${process.pid}.tmp`;
+			await writeFile(tmpPath, [...entries].map(([key, entry]) => formatLine(key, entry)).join(""));
+			await rename(tmpPath, path);
+		} else if (content && !content.endsWith("\n")) {
+			// Interrupted while appending, don't let the next entry continue the truncated line
+			await writeFile(path, "\n", { flag: "a" });
+		}
+
+		return new SHA256FileCache(await open(path, "a"), entries, opts?.fingerprint ?? false);
+	}
+
+	/** Identity of the files when they were looked up, before they are hashed */
+	private readonly identities = new WeakMap<Blob, FileIdentity>();
+	private writing: Promise<unknown> = Promise.resolve();
+
+	private constructor(
+		private readonly file: FileHandle,
+		private readonly entries: Map<string, Entry>,
+		private readonly fingerprint: boolean
+	) {}
+
+	async get(blob: Blob): Promise<string | undefined> {
+		if (!(blob instanceof FileBlob)) {
+			return undefined;
+		}
+
+		const identity = await this.identify(blob);
+		if (!identity) {
+			return undefined;
+		}
+		this.identities.set(blob, identity);
+
+		const entry = this.entries.get(blobKey(blob));
+		if (
+			entry &&
+			entry.size === identity.size &&
+			entry.mtimeMs === identity.mtimeMs &&
+			entry.ino === identity.ino &&
+			entry.dev === identity.dev &&
+			entry.fingerprint === identity.fingerprint
+		) {
+			return entry.sha;
+		}
+		return undefined;
+	}
+
+	/**
+	 * Only remembers blobs looked up with {@link get} before being hashed, and whose file didn't change since
+	 */
+	async set(blob: Blob, sha: string): Promise<void> {
+		const before = this.identities.get(blob);
+		if (!(blob instanceof FileBlob) || !before) {
+			return;
+		}
+
+		const after = await this.identify(blob, before.fingerprint);
+		if (
+			!after ||
+			after.size !== before.size ||
+			after.mtimeMs !== before.mtimeMs ||
+			after.ino !== before.ino ||
+			after.dev !== before.dev
+		) {
+			return;
+		}
+
+		const key = blobKey(blob);
+		const entry = { ...before, sha };
+		this.entries.set(key, entry);
+		const write = this.writing.then(() => this.file.write(formatLine(key, entry)));
+		// A failed write doesn't prevent the next ones
+		this.writing = write.catch(() => {});
+		await write;
+	}
+
+	async close(): Promise<void> {
+		await this.writing;
+		await this.file.close();
+	}
+
+	/**
+	 * @param fingerprint - reused instead of being computed again
+	 */
+	private async identify(blob: FileBlob, fingerprint?: string): Promise<FileIdentity | undefined> {
+		try {
+			const stats = await stat(blob.path);
+			return {
+				size: stats.size,
+				mtimeMs: stats.mtimeMs,
+				ino: stats.ino,
+				dev: stats.dev,
+				fingerprint: fingerprint ?? (this.fingerprint ? await sampledFingerprint(blob) : ""),
+			};
+		} catch {
+			return undefined;
+		}
+	}
+}
+
+function blobKey(blob: FileBlob): string {
+	return `${blob.start}\t${blob.end}\t${JSON.stringify(blob.path)}`;
+}
+
+function formatLine(key: string, entry: Entry): string {
+	return `${entry.sha}\t${entry.size}\t${entry.mtimeMs}\t${entry.ino}\t${entry.dev}\t${entry.fingerprint}\t${key}\n`;
+}
+
+function parseLine(line: string): { key: string; entry: Entry } | undefined {
+	const fields = line.split("\t");
+	if (fields.length < 9 || !/^[0-9a-f]{64}$/.test(fields[0])) {
+		return undefined;
+	}
+	const [sha, size, mtimeMs, ino, dev, fingerprint] = fields;
+	try {
+		// The path is JSON-encoded, and may contain tabs
+		JSON.parse(fields.slice(8).join("\t"));
+	} catch {
+		return undefined;
+	}
+	return {
+		key: fields.slice(6).join("\t"),
+		entry: { sha, size: Number(size), mtimeMs: Number(mtimeMs), ino: Number(ino), dev: Number(dev), fingerprint },
+	};
+}
+
+/**
+ * Hash of evenly spaced ranges of the blob
+ */
+async function sampledFingerprint(blob: FileBlob): Promise<string> {
+	const hash = createHash("sha256");
+	const file = await open(blob.path, "r");
+	try {
+		const step = Math.max(FINGERPRINT_SAMPLE_SIZE, Math.ceil(blob.size / FINGERPRINT_SAMPLES));
+		const sample = Buffer.alloc(FINGERPRINT_SAMPLE_SIZE);
+		for (let offset = 0; offset < blob.size; offset += step) {
+			const { bytesRead } = await file.read(
+				sample,
+				0,
+				Math.min(FINGERPRINT_SAMPLE_SIZE, blob.size - offset),
+				blob.start + offset
+			);
+			hash.update(sample.subarray(0, bytesRead));
+		}
+	} finally {
+		await file.close();
+	}
+	return hash.digest("hex").slice(0, 16);
+}
@@ -1,6 +1,48 @@
 import { Readable } from "node:stream";
 import type { ReadableStream } from "node:stream/web";
 import { createHash } from "node:crypto";
+import { promisify } from "node:util";
+import { FileBlob } from "./FileBlob";
+
+/**
+ * Optional native addon built from src/vendor/hash-wasm/native (`pnpm run build:native`, Linux only).
+ *
+ * Set `HF_HUB_SHA256_ADDON` to the path of the built `sha256.node` to use it.
+ */
+interface SHA256Addon {
+	/** "sha-ni", "avx2", "sse2" or "scalar" */
+	backend: string;
+	createHash(): object;
+	update(hash: object, data: Uint8Array, callback: (err: Error | null) => void): void;
+	updateFromFile(hash: object, path: string, start: number, end: number, callback: (err: Error | null) => void): void;
+	digest(hash: object): string;
+	hashFiles(
+		files: Array<{ path: string; start: number; end: number }>,
+		callback: (err: Error | null, shas: string[]) => void
+	): void;
+}
+
+/** Files are read by the addon in windows of this size, to report progress and check the abort signal */
+const NATIVE_FILE_WINDOW = 64 * 1024 * 1024;
+
+let addon: SHA256Addon | null | undefined;
+
+function loadAddon(): SHA256Addon | null {
+	if (addon === undefined) {
+		addon = null;
+		const path = process.env.HF_HUB_SHA256_ADDON;
+		if (path) {
+			try {
+				const module = { exports: {} };
+				process.dlopen(module, path);
+				addon = module.exports as SHA256Addon;
+			} catch (err) {
+				console.warn("Failed to load the native sha256 addon, falling back to node:crypto", err);
+			}
+		}
+	}
+	return addon;
+}
 
 export async function* sha256Node(
 	buffer: ArrayBuffer | Blob,
@@ -8,6 +50,11 @@ export async function* sha256Node(
 		abortSignal?: AbortSignal;
 	}
 ): AsyncGenerator<number, string> {
+	const native = loadAddon();
+	if (native) {
+		return yield* sha256Native(native, buffer, opts);
+	}
+
 	const sha256Stream = createHash("sha256");
 	const size = buffer instanceof Blob ? buffer.size : buffer.byteLength;
 	let done = 0;
@@ -24,3 +71,59 @@ export async function* sha256Node(
 
 	return sha256Stream.digest("hex");
 }
+
+async function* sha256Native(
+	native: SHA256Addon,
+	buffer: ArrayBuffer | Blob,
+	opts?: {
+		abortSignal?: AbortSignal;
+	}
+): AsyncGenerator<number, string> {
+	const hash = native.createHash();
+	const update = promisify(native.update);
+	const size = buffer instanceof Blob ? buffer.size : buffer.byteLength;
+	let done = 0;
+
+	if (buffer instanceof FileBlob) {
+		// Read and hash on the threadpool, without copying the file into JS memory
+		const updateFromFile = promisify(native.updateFromFile);
+		while (done < size) {
+			const end = Math.min(size, done + NATIVE_FILE_WINDOW);
+			await updateFromFile(hash, buffer.path, buffer.start + done, buffer.start + end);
+			done = end;
+			yield done / size;
+
+			opts?.abortSignal?.throwIfAborted();
+		}
+	} else {
+		const readable =
+			buffer instanceof Blob ? Readable.fromWeb(buffer.stream() as ReadableStream) : Readable.from(Buffer.from(buffer));
+
+		for await (const chunk of readable) {
+			await update(hash, chunk);
+			done += chunk.length;
+			yield done / size;
+
+			opts?.abortSignal?.throwIfAborted();
+		}
+	}
+
+	return native.digest(hash);
+}
+
+/**
+ * Hash all the files in a single call to the native addon, which spreads them over the threads of the libuv pool,
+ * and over SIMD lanes when it can.
+ *
+ * @returns undefined if the addon is not available or some blobs are not files
+ */
+export async function sha256FilesNative(blobs: Blob[]): Promise<string[] | undefined> {
+	const native = loadAddon();
+	if (!native || !blobs.every((blob) => blob instanceof FileBlob)) {
+		return undefined;
+	}
+
+	return promisify(native.hashFiles)(
+		(blobs as FileBlob[]).map((blob) => ({ path: blob.path, start: blob.start, end: blob.start + blob.size }))
+	);
+}
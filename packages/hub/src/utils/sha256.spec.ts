@@ -1,5 +1,7 @@
-import { describe, it, expect } from "vitest";
-import { sha256 } from "./sha256";
+import { describe, it, expect, vi } from "vitest";
+import { sha256, sha256Batch, sha256Files } from "./sha256";
+import type { SHA256Checkpoint, SHA256DigestIndexEntry } from "./sha256";
+import { isFrontend } from "./isFrontend";
 
 const smallContent = "hello world";
 const smallContentSHA256 = "b94d27b9934d3e08a52e52d7da7dabfac484efe37a5380ee9088f7ace2efcde9";
@@ -7,15 +9,26 @@ const bigContent = "O123456789".repeat(100_000);
 const bigContentSHA256 = "a3bbce7ee1df7233d85b5f4d60faa3755f93f537804f8b540c72b0739239ddf8";
 const biggerContent = "0123456789".repeat(1_000_000);
 const biggerContentSHA256 = "d52fcc26b48dbd4d79b125eb0a29b803ade07613c67ac7c6f2751aefef008486";
+const appendedContent = biggerContent + "appended line\n";
+const appendedContentSHA256 = "80f15b4b9c1bda97a5bb5fbfef295d33840c9029cecab054f845f41c5f89624c";
+
+/**
+ * Run the iterator to completion, passing each yielded value to `onValue`, and return its result
+ */
+async function iterate<Y, R>(iterator: AsyncGenerator<Y, R>, onValue?: (value: Y) => void): Promise<R> {
+	let res: IteratorResult<Y, R>;
+	do {
+		res = await iterator.next();
+		if (!res.done) {
+			onValue?.(res.value);
+		}
+	} while (!res.done);
+	return res.value;
+}
 
 describe("sha256", () => {
 	async function calcSHA256(content: string, useWebWorker: boolean) {
-		const iterator = sha256(new Blob([content]), { useWebWorker });
-		let res: IteratorResult<number, string>;
-		do {
-			res = await iterator.next();
-		} while (!res.done);
-		return res.value;
+		return iterate(sha256(new Blob([content]), { useWebWorker }));
 	}
 
 	it("Calculate hash of a small file", async () => {
@@ -33,6 +46,156 @@ describe("sha256", () => {
 		expect(sha).toBe(biggerContentSHA256);
 	});
 
+	it("Resume hashing from a checkpoint", async () => {
+		const checkpoints: SHA256Checkpoint[] = [];
+
+		let cleared = false;
+		const sha = await iterate(
+			sha256(new Blob([biggerContent]), {
+				checkpoint: {
+					every: 1_000_000,
+					store: { load: () => undefined, save: (c) => void checkpoints.push(c), clear: () => void (cleared = true) },
+				},
+			})
+		);
+		expect(sha).toBe(biggerContentSHA256);
+		expect(checkpoints.length).toBeGreaterThan(2);
+		expect(checkpoints[2].size).toBe(biggerContent.length);
+		expect(cleared).toBe(true);
+
+		const resumed = await iterate(
+			sha256(new Blob([biggerContent]), {
+				checkpoint: { store: { load: () => checkpoints[2], save: () => {}, clear: () => {} } },
+			})
+		);
+		expect(resumed).toBe(biggerContentSHA256);
+	});
+
+	it("Resume after content changed", async () => {
+		const checkpoints: SHA256Checkpoint[] = [];
+		const store = {
+			load: () => checkpoints[2],
+			save: (c: SHA256Checkpoint) => void checkpoints.push(c),
+			clear: () => {},
+		};
+
+		await iterate(
+			sha256(new File([biggerContent], "file.txt", { lastModified: 1000 }), { checkpoint: { every: 1_000_000, store } })
+		);
+		expect(checkpoints.length).toBeGreaterThan(2);
+		expect(checkpoints[2].lastModified).toBe(1000);
+
+		// Data appended: the size changed
+		const appended = await iterate(
+			sha256(new File([appendedContent], "file.txt", { lastModified: 1000 }), { checkpoint: { store } })
+		);
+		expect(appended).toBe(appendedContentSHA256);
+
+		// Data modified in place: same size, but a new modification time
+		const modifiedContent = "x" + biggerContent.slice(1);
+		const modified = await iterate(
+			sha256(new File([modifiedContent], "file.txt", { lastModified: 2000 }), { checkpoint: { store } })
+		);
+		expect(modified).toBe(await calcSHA256(modifiedContent, false));
+	});
+
+	it("Only hash appended data when the prefix is unchanged", async () => {
+		let entry: SHA256DigestIndexEntry | undefined;
+		const digestIndex = { load: () => entry, save: (e: SHA256DigestIndexEntry) => void (entry = e) };
+
+		expect(await iterate(sha256(new Blob([biggerContent]), { digestIndex }))).toBe(biggerContentSHA256);
+		expect(entry?.size).toBe(biggerContent.length);
+
+		const progress: number[] = [];
+		const second = await iterate(sha256(new Blob([appendedContent]), { digestIndex }), (p) => progress.push(p));
+		expect(second).toBe(appendedContentSHA256);
+		// Progress jumps straight to the previous end of the file
+		expect(progress[1]).toBeGreaterThan(0.99);
+		expect(entry?.size).toBe(appendedContent.length);
+	});
+
+	it("Use the digest index below the size where crypto.subtle is used", async () => {
+		let entry: SHA256DigestIndexEntry | undefined;
+		const digestIndex = { load: () => entry, save: (e: SHA256DigestIndexEntry) => void (entry = e) };
+
+		for (const content of [bigContent, bigContent + smallContent]) {
+			expect(await iterate(sha256(new Blob([content]), { digestIndex }))).toBe(await calcSHA256(content, false));
+			expect(entry?.size).toBe(content.length);
+		}
+	});
+
+	it("Calculate hashes of many files at once", async () => {
+		const shas = await sha256Batch([
+			new Blob([smallContent]),
+			new Blob([bigContent]),
+			new Blob([]),
+			new Blob([smallContent]),
+			new Blob([bigContent]),
+		]);
+		expect(shas).toEqual([
+			smallContentSHA256,
+			bigContentSHA256,
+			"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+			smallContentSHA256,
+			bigContentSHA256,
+		]);
+	});
+
+	it("Calculate hashes of several files on the SIMD lanes", async () => {
+		const { createSHA256 } = await import("../vendor/hash-wasm/sha256-wrapper");
+		const contents = [biggerContent, bigContent, smallContent, "", appendedContent, bigContent + smallContent];
+		const progress = new Map<number, number>();
+		const shas = await (
+			await createSHA256()
+		).hashMany(
+			contents.map((content) => new Blob([content])),
+			(index, value) => progress.set(index, value)
+		);
+
+		expect(shas).toEqual(await Promise.all(contents.map((content) => calcSHA256(content, false))));
+		expect([...progress.keys()].sort()).toEqual([...contents.keys()]);
+		expect(new Set(progress.values())).toEqual(new Set([1]));
+	});
+
+	it.skipIf(!isFrontend)("Calculate hashes of the big files together without web workers", async () => {
+		const shas = await iterate(
+			sha256Files([new Blob([biggerContent]), new Blob([smallContent]), new Blob([appendedContent])])
+		);
+		expect(shas).toEqual([biggerContentSHA256, smallContentSHA256, appendedContentSHA256]);
+	});
+
+	it.skipIf(!globalThis.crypto?.subtle)("Hash many files in parallel within the memory budget", async () => {
+		// Slow crypto.subtle down so that all the digests overlap, and track the bytes it holds at once
+		const digest = globalThis.crypto.subtle.digest.bind(globalThis.crypto.subtle);
+		let inFlight = 0;
+		let peak = 0;
+		let calls = 0;
+		const spy = vi
+			.spyOn(globalThis.crypto.subtle, "digest")
+			.mockImplementation(async (algorithm: AlgorithmIdentifier, data: BufferSource) => {
+				calls++;
+				inFlight += data.byteLength;
+				peak = Math.max(peak, inFlight);
+				try {
+					await new Promise((resolve) => setTimeout(resolve, 10));
+					return await digest(algorithm, data);
+				} finally {
+					inFlight -= data.byteLength;
+				}
+			});
+
+		try {
+			// 150 x 1MB files read in memory at the same time would be above the budget, some of them are streamed
+			const shas = await Promise.all(Array.from({ length: 150 }, () => iterate(sha256(new Blob([bigContent])))));
+			expect(new Set(shas)).toEqual(new Set([bigContentSHA256]));
+			expect(peak).toBeLessThanOrEqual(100_000_000);
+			expect(calls).toBeGreaterThan(0);
+			expect(calls).toBeLessThan(150);
+		} finally {
+			spy.mockRestore();
+		}
+	});
+
 	it("Calculate hash of a small file (+ web worker)", async () => {
 		const sha = await calcSHA256(smallContent, true);
 		expect(sha).toBe(smallContentSHA256);
@@ -47,4 +210,100 @@ describe("sha256", () => {
 		const sha = await calcSHA256(biggerContent, true);
 		expect(sha).toBe(biggerContentSHA256);
 	});
+
+	// In node, useWebWorker is ignored: only the browser tests go through the web workers
+	it.skipIf(!isFrontend)("Hash again after aborting, with the same web worker", async () => {
+		// Without shared memory, the web workers are used instead of the threaded build and cancelled by message
+		vi.stubGlobal("crossOriginIsolated", false);
+		let created = 0;
+		let terminated = 0;
+		vi.stubGlobal(
+			"Worker",
+			class extends Worker {
+				constructor(...args: ConstructorParameters<typeof Worker>) {
+					super(...args);
+					created++;
+				}
+				override terminate() {
+					terminated++;
+					super.terminate();
+				}
+			}
+		);
+
+		try {
+			const controller = new AbortController();
+			const useWebWorker = { poolSize: 1 };
+			const iterator = sha256(new Blob([biggerContent]), { useWebWorker, abortSignal: controller.signal });
+			// Abort once the worker reported some progress, in the middle of the file
+			let res: IteratorResult<number, string>;
+			do {
+				res = await iterator.next();
+			} while (!res.done && res.value === 0);
+			expect(res.done).toBe(false);
+			controller.abort();
+			await expect(iterate(iterator)).rejects.toThrow();
+
+			const createdBefore = created;
+			expect(await iterate(sha256(new Blob([biggerContent]), { useWebWorker }))).toBe(biggerContentSHA256);
+			// The cancelled worker was kept in the pool and hashed the file again
+			expect(created).toBe(createdBefore);
+			expect(terminated).toBe(0);
+		} finally {
+			vi.unstubAllGlobals();
+		}
+	});
+
+	it.skipIf(!isFrontend)("Calculate hashes of many files of mixed sizes with the pool of web workers", async () => {
+		// Without shared memory, the files are sent by batches to the web workers instead of the threaded build
+		vi.stubGlobal("crossOriginIsolated", false);
+		const postMessage = vi.spyOn(Worker.prototype, "postMessage");
+
+		try {
+			// One big file for one worker, the other one has several batches of small files to share once it's done
+			const contents = Array.from({ length: 40 }, (_, i) => `file ${i} `.repeat(1_000 * ((i * 7) % 40) + 1));
+			contents[5] = biggerContent;
+			const digests: Array<[number, string]> = [];
+			const shas = await iterate(
+				sha256Files(contents.map((content) => new Blob([content])), { useWebWorker: { minSize: 0, poolSize: 2 } }),
+				(event) => {
+					if (event.sha256) {
+						digests.push([event.index, event.sha256]);
+					}
+				}
+			);
+
+			const expected = await Promise.all(contents.map((content) => calcSHA256(content, false)));
+			expect(shas).toEqual(expected);
+			// Each file reported once, with its own digest
+			expect(digests.sort(([a], [b]) => a - b)).toEqual([...expected.entries()]);
+			const batches = postMessage.mock.calls.filter(([message]) => message?.files);
+			expect(batches.length).toBeGreaterThan(2);
+			expect(batches.reduce((count, [message]) => count + message.files.length, 0)).toBe(contents.length);
+		} finally {
+			postMessage.mockRestore();
+			vi.unstubAllGlobals();
+		}
+	});
+
+	// The browser tests are served cross-origin isolated, see vitest-browser.config.mts
+	it.skipIf(!isFrontend)("Calculate hashes of several files with the threaded build", async () => {
+		expect(globalThis.crossOriginIsolated).toBe(true);
+		// Directly, as sha256Files falls back to the web workers if the threads fail to start
+		const { createSHA256Threads } = await import("../vendor/hash-wasm/sha256-threads-wrapper");
+		// The pool may already have been started by the previous tests, with another size
+		const threads = await createSHA256Threads(2);
+		expect(threads.threads).toBeGreaterThan(0);
+		expect(await threads.hashFiles([new Blob([biggerContent]), new Blob([smallContent])])).toEqual([
+			biggerContentSHA256,
+			smallContentSHA256,
+		]);
+
+		const shas = await iterate(
+			sha256Files([new Blob([biggerContent]), new Blob([smallContent]), new Blob([bigContent])], {
+				useWebWorker: { minSize: 0, poolSize: 2 },
+			})
+		);
+		expect(shas).toEqual([biggerContentSHA256, smallContentSHA256, bigContentSHA256]);
+	});
 });
@@ -2,9 +2,15 @@ import { eventToGenerator } from "./eventToGenerator";
 import { hexFromBytes } from "./hexFromBytes";
 import { isFrontend } from "./isFrontend";
 
-async function getWebWorkerCode() {
+let webWorkerCodeUrl: string | undefined;
+
+async function createWorker(): Promise<Worker> {
 	const sha256Module = await import("../vendor/hash-wasm/sha256-wrapper");
-	return URL.createObjectURL(new Blob([sha256Module.createSHA256WorkerCode()]));
+	webWorkerCodeUrl ??= URL.createObjectURL(new Blob([sha256Module.createSHA256WorkerCode()]));
+	const worker = new Worker(webWorkerCodeUrl);
+	// The WASM binary is compiled once on the main thread, workers only instantiate it
+	worker.postMessage({ module: await sha256Module.compileSHA256Module() });
+	return worker;
 }
 
 const pendingWorkers: Worker[] = [];
@@ -24,7 +30,7 @@ async function getWorker(poolSize?: number): Promise<Worker> {
 		}
 	}
 	if (!poolSize) {
-		const worker = new Worker(await getWebWorkerCode());
+		const worker = await createWorker();
 		runningWorkers.add(worker);
 		return worker;
 	}
@@ -37,7 +43,7 @@ async function getWorker(poolSize?: number): Promise<Worker> {
 		await waitPromise;
 	}
 
-	const worker = new Worker(await getWebWorkerCode());
+	const worker = await createWorker();
 	runningWorkers.add(worker);
 	return worker;
 }
@@ -65,26 +71,220 @@ function destroyWorker(worker: Worker): void {
 	r();
 }
 
+/** How often the progress counters shared with the workers are read, in ms */
+const DEFAULT_PROGRESS_INTERVAL = 100;
+
+/**
+ * SharedArrayBuffer is only available in cross-origin isolated pages
+ */
+function supportsSharedMemory(): boolean {
+	return typeof SharedArrayBuffer !== "undefined" && !!globalThis.crossOriginIsolated;
+}
+
+/**
+ * Number of bytes hashed for each file, written by the workers and sampled by the main thread.
+ *
+ * Undefined when SharedArrayBuffer is not available, outside of cross-origin isolated pages: workers then post
+ * a progress message after each chunk.
+ */
+function createProgressCounters(count: number): BigUint64Array | undefined {
+	if (!supportsSharedMemory()) {
+		return undefined;
+	}
+	return new BigUint64Array(new SharedArrayBuffer(8 * Math.max(1, count)));
+}
+
+/**
+ * Threaded build of the WASM module, used instead of the web workers in cross-origin isolated pages: a single module
+ * memory shared by a pool of threads.
+ *
+ * Undefined when shared memory is not available or the module failed to start, the web workers are then used.
+ */
+async function getSHA256Threads(
+	poolSize: number | undefined
+): Promise<Awaited<ReturnType<typeof threadsModule.createSHA256Threads>> | undefined> {
+	if (!supportsSharedMemory()) {
+		return undefined;
+	}
+	try {
+		if (!threadsModule) {
+			threadsModule = await import("../vendor/hash-wasm/sha256-threads-wrapper");
+		}
+		return await threadsModule.createSHA256Threads(poolSize ?? (navigator.hardwareConcurrency || 4));
+	} catch (err) {
+		console.warn("Failed to use the threaded build for sha256", err);
+		return undefined;
+	}
+}
+
+/**
+ * Files below `minSize` are read whole in memory for crypto.subtle, as long as all the files being read that way
+ * stay below this many bytes. The others are streamed.
+ */
+const SUBTLE_MEMORY_BUDGET = 100_000_000;
+let subtleBytesInFlight = 0;
+
+/** How long a cancelled worker has to stop before it's terminated, in ms */
+const CANCEL_TIMEOUT = 1000;
+
+let nextJobId = 0;
+
+/**
+ * Cancel a job running in a worker, without terminating it so that it can go back to the pool.
+ *
+ * The flag is shared with the worker when SharedArrayBuffer is available, and checked between each slice passed to
+ * the WASM module. Otherwise a `{ cancelId }` message is sent, handled by the worker between two chunks of the file.
+ */
+function createCancellation(worker: Worker): { id: number; flag: Int32Array | undefined; cancel: () => void } {
+	const id = nextJobId++;
+	const flag = supportsSharedMemory() ? new Int32Array(new SharedArrayBuffer(4)) : undefined;
+	return {
+		id,
+		flag,
+		cancel: () => {
+			if (flag) {
+				Atomics.store(flag, 0, 1);
+			} else {
+				worker.postMessage({ cancelId: id });
+			}
+		},
+	};
+}
+
+export interface SHA256Checkpoint {
+	/** Number of bytes of the file already hashed */
+	offset: number;
+	/** Internal state of the hash after `offset` bytes */
+	state: Uint8Array;
+	/** Size of the file when the checkpoint was saved, the checkpoint is ignored if it changed */
+	size: number;
+	/** `lastModified` of the file when the checkpoint was saved, if it is a `File`. Ignored too if it changed */
+	lastModified?: number;
+}
+
+/**
+ * Where to persist the checkpoints of a single file, for example in IndexedDB or on disk
+ */
+export interface SHA256CheckpointStore {
+	load(): Promise<SHA256Checkpoint | undefined> | SHA256Checkpoint | undefined;
+	save(checkpoint: SHA256Checkpoint): Promise<void> | void;
+	/** Called once the hash is complete, the checkpoint is of no use anymore */
+	clear(): Promise<void> | void;
+}
+
+/**
+ * What is remembered about a file to rehash it quickly once data is appended to it
+ */
+export interface SHA256DigestIndexEntry {
+	/** Size of the file when it was last hashed */
+	size: number;
+	/** Largest multiple of the SHA256 block size (64 bytes) lower or equal to `size` */
+	offset: number;
+	/** Internal state of the hash after `offset` bytes */
+	state: Uint8Array;
+	/** Fingerprint of sampled ranges of the first `offset` bytes, to detect changes before the appended data */
+	prefixCheck: string;
+}
+
+/**
+ * Where to persist the digest index entry of a single file
+ */
+export interface SHA256DigestIndexStore {
+	load(): Promise<SHA256DigestIndexEntry | undefined> | SHA256DigestIndexEntry | undefined;
+	save(entry: SHA256DigestIndexEntry): Promise<void> | void;
+}
+
+/**
+ * Shas computed before, to skip hashing files that didn't change
+ */
+export interface SHA256Cache {
+	get(buffer: Blob): Promise<string | undefined> | string | undefined;
+	set(buffer: Blob, sha: string): Promise<void> | void;
+}
+
 /**
  * @returns hex-encoded sha
  * @yields progress (0-1)
  */
 export async function* sha256(
 	buffer: Blob,
-	opts?: { useWebWorker?: boolean | { minSize?: number; poolSize?: number }; abortSignal?: AbortSignal }
+	opts?: {
+		useWebWorker?: boolean | { minSize?: number; poolSize?: number; progressInterval?: number };
+		abortSignal?: AbortSignal;
+		/**
+		 * Periodically save the state of the hash, so that an interrupted computation can resume from the last checkpoint
+		 * instead of rehashing the whole file.
+		 *
+		 * Hashing is then done on the main thread with WASM, since neither `crypto.subtle` nor `node:crypto` can export their state.
+		 */
+		checkpoint?: {
+			store: SHA256CheckpointStore;
+			/**
+			 * Save a checkpoint every `every` bytes
+			 *
+			 * @default 1_000_000_000
+			 */
+			every?: number;
+		};
+		/**
+		 * Remember the state of the hash at the end of the file, so that if the file is only appended to,
+		 * the next computation only hashes the new data.
+		 *
+		 * The prefix is only checked by sampling a few ranges, modifications outside of those ranges
+		 * are not detected. Only use it for append-only files.
+		 *
+		 * Like `checkpoint`, hashing is then done on the main thread with WASM, whatever the size of the file.
+		 */
+		digestIndex?: SHA256DigestIndexStore;
+		/**
+		 * Looked up before reading the blob, and updated with the computed sha
+		 */
+		cache?: SHA256Cache;
+	}
 ): AsyncGenerator<number, string> {
+	if (opts?.cache) {
+		const cached = await opts.cache.get(buffer);
+		if (cached) {
+			yield 1;
+			return cached;
+		}
+		const sha = yield* sha256(buffer, { ...opts, cache: undefined });
+		await opts.cache.set(buffer, sha);
+		return sha;
+	}
+
 	yield 0;
 
+	// Whatever the size of the file: both need the WASM module, the only one able to export its state
+	if (opts?.digestIndex) {
+		return yield* sha256Appendable(buffer, opts.digestIndex, opts.abortSignal);
+	}
+
+	if (opts?.checkpoint) {
+		return yield* sha256WithCheckpoints(buffer, opts.checkpoint, opts.abortSignal);
+	}
+
 	const maxCryptoSize =
 		typeof opts?.useWebWorker === "object" && opts?.useWebWorker.minSize !== undefined
 			? opts.useWebWorker.minSize
 			: 10_000_000;
 	if (buffer.size < maxCryptoSize && globalThis.crypto?.subtle) {
-		const res = hexFromBytes(
-			new Uint8Array(
-				await globalThis.crypto.subtle.digest("SHA-256", buffer instanceof Blob ? await buffer.arrayBuffer() : buffer)
-			)
-		);
+		if (subtleBytesInFlight + buffer.size > SUBTLE_MEMORY_BUDGET) {
+			// Too many files in memory already, stream this one instead
+			return yield* sha256Streaming(buffer, opts?.abortSignal);
+		}
+
+		subtleBytesInFlight += buffer.size;
+		let res: string;
+		try {
+			res = hexFromBytes(
+				new Uint8Array(
+					await globalThis.crypto.subtle.digest("SHA-256", buffer instanceof Blob ? await buffer.arrayBuffer() : buffer)
+				)
+			);
+		} finally {
+			subtleBytesInFlight -= buffer.size;
+		}
 
 		yield 1;
 
@@ -95,43 +295,116 @@ export async function* sha256(
 		if (opts?.useWebWorker) {
 			try {
 				const poolSize = typeof opts?.useWebWorker === "object" ? opts.useWebWorker.poolSize : undefined;
+				const progressInterval =
+					(typeof opts?.useWebWorker === "object" && opts.useWebWorker.progressInterval) || DEFAULT_PROGRESS_INTERVAL;
+				opts.abortSignal?.throwIfAborted();
+				const threads = await getSHA256Threads(poolSize);
+				if (threads) {
+					return yield* eventToGenerator<number, string>((yieldCallback, returnCallback, rejectCallack) =>
+						threads
+							.hashFiles([buffer], {
+								abortSignal: opts.abortSignal,
+								onProgress: (_, progress) => yieldCallback(progress),
+							})
+							.then(([sha]) => returnCallback(sha), rejectCallack)
+					);
+				}
 				const worker = await getWorker(poolSize);
+				const counters = createProgressCounters(1);
+				const cancellation = createCancellation(worker);
 				return yield* eventToGenerator<number, string>((yieldCallback, returnCallback, rejectCallack) => {
-					worker.addEventListener("message", (event) => {
-						if (event.data.sha256) {
+					let sampler: ReturnType<typeof setInterval> | undefined;
+					let cancelTimer: ReturnType<typeof setTimeout> | undefined;
+					const cleanup = () => {
+						clearInterval(sampler);
+						clearTimeout(cancelTimer);
+						worker.removeEventListener("message", onMessage);
+						worker.removeEventListener("error", onError);
+						opts.abortSignal?.removeEventListener("abort", onAbort);
+					};
+					const fail = (err: unknown) => {
+						cleanup();
+						destroyWorker(worker);
+						rejectCallack(err);
+					};
+					const onMessage = (event: MessageEvent) => {
+						if (event.data.sha256 || event.data.cancelled) {
+							cleanup();
 							freeWorker(worker, poolSize);
-							returnCallback(event.data.sha256);
-						} else if (event.data.progress) {
-							yieldCallback(event.data.progress);
-
-							try {
-								opts.abortSignal?.throwIfAborted();
-							} catch (err) {
-								destroyWorker(worker);
-								rejectCallack(err);
+							if (opts.abortSignal?.aborted) {
+								// The worker may have finished just before the cancellation reached it
+								rejectCallack(opts.abortSignal.reason);
+							} else {
+								returnCallback(event.data.sha256);
 							}
+						} else if (event.data.progress !== undefined) {
+							yieldCallback(event.data.progress);
 						} else {
-							destroyWorker(worker);
-							rejectCallack(event);
+							fail(event);
 						}
+					};
+					const onError = (event: ErrorEvent) => fail(event.error);
+					const onAbort = () => {
+						clearInterval(sampler);
+						cancellation.cancel();
+						cancelTimer = setTimeout(() => fail(opts.abortSignal?.reason), CANCEL_TIMEOUT);
+					};
+
+					worker.addEventListener("message", onMessage);
+					worker.addEventListener("error", onError);
+					opts.abortSignal?.addEventListener("abort", onAbort);
+					if (opts.abortSignal?.aborted) {
+						// Aborted while waiting for a worker
+						onAbort();
+					}
+					if (counters) {
+						let lastBytesDone = 0;
+						sampler = setInterval(() => {
+							const bytesDone = Number(Atomics.load(counters, 0));
+							if (bytesDone !== lastBytesDone) {
+								lastBytesDone = bytesDone;
+								yieldCallback(bytesDone / buffer.size);
+							}
+						}, progressInterval);
+					}
+					worker.postMessage({
+						id: cancellation.id,
+						file: buffer,
+						poolSize,
+						counters,
+						cancel: cancellation.flag,
 					});
-					worker.addEventListener("error", (event) => {
-						destroyWorker(worker);
-						rejectCallack(event.error);
-					});
-					worker.postMessage({ file: buffer });
 				});
 			} catch (err) {
 				console.warn("Failed to use web worker for sha256", err);
 			}
 		}
-		if (!wasmModule) {
-			wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
+	}
+
+	return yield* sha256Streaming(buffer, opts?.abortSignal);
+}
+
+/**
+ * Hash on the main thread, without reading the whole blob in memory
+ */
+async function* sha256Streaming(buffer: Blob, abortSignal?: AbortSignal): AsyncGenerator<number, string> {
+	if (!isFrontend) {
+		if (!cryptoModule) {
+			cryptoModule = await import("./sha256-node");
 		}
 
-		const sha256 = await wasmModule.createSHA256();
-		sha256.init();
+		return yield* cryptoModule.sha256Node(buffer, { abortSignal });
+	}
+
+	if (!wasmModule) {
+		wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
+	}
+
+	// Instances share the same WASM module, each hash only takes a context inside of it
+	const sha256 = await wasmModule.createSHA256(false, { sizeHint: buffer.size });
+	sha256.init();
 
+	try {
 		const reader = buffer.stream().getReader();
 		const total = buffer.size;
 		let bytesDone = 0;
@@ -147,20 +420,477 @@ export async function* sha256(
 			bytesDone += value.length;
 			yield bytesDone / total;
 
-			opts?.abortSignal?.throwIfAborted();
+			abortSignal?.throwIfAborted();
+		}
+
+		return sha256.digest("hex");
+	} finally {
+		sha256.destroy();
+	}
+}
+
+async function* sha256WithCheckpoints(
+	buffer: Blob,
+	checkpoint: { store: SHA256CheckpointStore; every?: number },
+	abortSignal?: AbortSignal
+): AsyncGenerator<number, string> {
+	if (!wasmModule) {
+		wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
+	}
+
+	const sha256 = await wasmModule.createSHA256(false, { sizeHint: buffer.size });
+	const every = checkpoint.every ?? 1_000_000_000;
+	const saved = await checkpoint.store.load();
+	const total = buffer.size;
+	const lastModified = (buffer as Partial<File>).lastModified;
+	let bytesDone = 0;
+
+	try {
+		// A checkpoint of another version of the file would give a wrong hash
+		if (saved && saved.offset && saved.size === total && saved.lastModified === lastModified) {
+			sha256.load(saved.state);
+			bytesDone = saved.offset;
+			yield bytesDone / total;
+		} else {
+			sha256.init();
+		}
+
+		let lastCheckpoint = bytesDone;
+		const reader = buffer.slice(bytesDone).stream().getReader();
+
+		while (true) {
+			const { done, value } = await reader.read();
+
+			if (done) {
+				break;
+			}
+
+			sha256.update(value);
+			bytesDone += value.length;
+
+			if (bytesDone - lastCheckpoint >= every) {
+				await checkpoint.store.save({ offset: bytesDone, state: sha256.save(), size: total, lastModified });
+				lastCheckpoint = bytesDone;
+			}
+
+			yield bytesDone / total;
+
+			abortSignal?.throwIfAborted();
+		}
+
+		const digest = sha256.digest("hex");
+		await checkpoint.store.clear();
+		return digest;
+	} finally {
+		sha256.destroy();
+	}
+}
+
+/** Blobs are read in memory by batches of at most this size */
+const SHA256_BATCH_SIZE = 8_000_000;
+
+/**
+ * Hash many small blobs with a few calls to the WASM module, instead of one {@link sha256} computation per blob.
+ *
+ * Blobs are read entirely in memory, bigger blobs should go through {@link sha256}.
+ *
+ * @returns hex-encoded shas, in the same order as the blobs
+ */
+export async function sha256Batch(blobs: Blob[], opts?: { abortSignal?: AbortSignal }): Promise<string[]> {
+	if (!isFrontend) {
+		if (!cryptoModule) {
+			cryptoModule = await import("./sha256-node");
+		}
+
+		const shas = await cryptoModule.sha256FilesNative(blobs);
+		if (shas) {
+			return shas;
+		}
+	}
+
+	if (!wasmModule) {
+		wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
+	}
+
+	const sha256 = await wasmModule.createSHA256();
+	const results: string[] = [];
+	let start = 0;
+
+	while (start < blobs.length) {
+		let end = start;
+		let batchSize = 0;
+		do {
+			batchSize += blobs[end].size;
+			end++;
+		} while (end < blobs.length && batchSize + blobs[end].size <= SHA256_BATCH_SIZE);
+
+		const buffers = await Promise.all(
+			blobs.slice(start, end).map(async (blob) => new Uint8Array(await blob.arrayBuffer()))
+		);
+		opts?.abortSignal?.throwIfAborted();
+
+		results.push(...sha256.hashBatch(buffers));
+		start = end;
+	}
+
+	return results;
+}
+
+/** The SIMD lanes of the WASM module are used by one {@link sha256Files} call at a time */
+let lanesBusy = false;
+
+/** A worker receives at most this many files in a single message */
+const WORKER_BATCH_MAX_FILES = 16;
+/** A worker receives at most this many bytes in a single message, unless a single file is bigger */
+const WORKER_BATCH_MAX_SIZE = 256_000_000;
+
+/**
+ * Hash several files, sending the big ones to the pool of web workers by batches instead of one message per file.
+ *
+ * Files are spread over one queue per worker, balanced by size. A worker whose queue is empty steals the second half
+ * of the longest queue, so that all workers stay busy until the end.
+ *
+ * In cross-origin isolated pages, the files are hashed by the threaded build of the WASM module instead, with a pool
+ * of `poolSize` threads sharing the module memory. The pool is created by the first call and reused by the next ones.
+ *
+ * In browsers without web workers, the files of at least `minSize` bytes, too big for crypto.subtle, are hashed
+ * together on the SIMD lanes of the WASM module.
+ *
+ * The other files, and all files outside of browsers, go through {@link sha256}.
+ *
+ * @returns hex-encoded shas, in the same order as the blobs
+ * @yields progress (0-1) of the file at `index`, with its `sha256` once hashed
+ */
+export async function* sha256Files(
+	blobs: Blob[],
+	opts?: {
+		useWebWorker?: boolean | { minSize?: number; poolSize?: number; progressInterval?: number };
+		abortSignal?: AbortSignal;
+	}
+): AsyncGenerator<{ index: number; progress: number; sha256?: string }, string[]> {
+	const results: string[] = new Array(blobs.length);
+	const minSize =
+		typeof opts?.useWebWorker === "object" && opts.useWebWorker.minSize !== undefined
+			? opts.useWebWorker.minSize
+			: 10_000_000;
+	const workerIndices =
+		isFrontend && opts?.useWebWorker ? [...blobs.keys()].filter((i) => blobs[i].size >= minSize) : [];
+	// Biggest first, so that the files hashed in lock-step have similar sizes
+	const laneIndices =
+		isFrontend && !opts?.useWebWorker && !lanesBusy
+			? [...blobs.keys()].filter((i) => blobs[i].size >= minSize).sort((a, b) => blobs[b].size - blobs[a].size)
+			: [];
+	const skippedIndices = new Set(laneIndices.length > 1 ? [...workerIndices, ...laneIndices] : workerIndices);
+
+	if (laneIndices.length > 1) {
+		lanesBusy = true;
+		try {
+			if (!wasmModule) {
+				wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
+			}
+			const sha256 = await wasmModule.createSHA256();
+			yield* eventToGenerator<{ index: number; progress: number; sha256?: string }, void>(
+				(yieldCallback, returnCallback, rejectCallack) =>
+					sha256
+						.hashMany(
+							laneIndices.map((index) => blobs[index]),
+							(i, progress) => {
+								opts?.abortSignal?.throwIfAborted();
+								yieldCallback({ index: laneIndices[i], progress });
+							}
+						)
+						.then((shas) => {
+							for (const [i, sha] of shas.entries()) {
+								results[laneIndices[i]] = sha;
+								yieldCallback({ index: laneIndices[i], progress: 1, sha256: sha });
+							}
+							returnCallback();
+						}, rejectCallack)
+			);
+		} finally {
+			lanesBusy = false;
+		}
+	}
+
+	for (const [index, blob] of blobs.entries()) {
+		if (skippedIndices.has(index)) {
+			continue;
+		}
+		const iterator = sha256(blob, { useWebWorker: opts?.useWebWorker, abortSignal: opts?.abortSignal });
+		let res: IteratorResult<number, string>;
+		do {
+			res = await iterator.next();
+			if (!res.done) {
+				yield { index, progress: res.value };
+			}
+		} while (!res.done);
+		results[index] = res.value;
+		yield { index, progress: 1, sha256: res.value };
+	}
+
+	if (!workerIndices.length) {
+		return results;
+	}
+
+	const poolSize = typeof opts?.useWebWorker === "object" ? opts.useWebWorker.poolSize : undefined;
+	const progressInterval =
+		(typeof opts?.useWebWorker === "object" && opts.useWebWorker.progressInterval) || DEFAULT_PROGRESS_INTERVAL;
+
+	const threads = await getSHA256Threads(poolSize);
+	if (threads) {
+		// Biggest files first, so that the threads finish at about the same time
+		const order = [...workerIndices].sort((a, b) => blobs[b].size - blobs[a].size);
+		const files = order.map((index) => blobs[index]);
+		return yield* eventToGenerator<{ index: number; progress: number; sha256?: string }, string[]>(
+			(yieldCallback, returnCallback, rejectCallack) =>
+				threads
+					.hashFiles(files, {
+						abortSignal: opts?.abortSignal,
+						onProgress: (i, progress) => yieldCallback({ index: order[i], progress }),
+						onDigest: (i, sha256) => {
+							results[order[i]] = sha256;
+							yieldCallback({ index: order[i], progress: 1, sha256 });
+						},
+					})
+					.then(() => returnCallback(results), rejectCallack)
+		);
+	}
+
+	const workerCount = Math.min(workerIndices.length, poolSize ?? (navigator.hardwareConcurrency || 4));
+
+	// Biggest files first, each to the least loaded queue
+	const queues: number[][] = Array.from({ length: workerCount }, () => []);
+	const loads: number[] = new Array(workerCount).fill(0);
+	for (const index of workerIndices.sort((a, b) => blobs[b].size - blobs[a].size)) {
+		const target = loads.indexOf(Math.min(...loads));
+		queues[target].push(index);
+		loads[target] += blobs[index].size;
+	}
+
+	let failed = false;
+	const nextBatch = (queue: number): number[] => {
+		if (failed) {
+			return [];
+		}
+		if (!queues[queue].length) {
+			const victim = queues.reduce((longest, q, i) => (q.length > queues[longest].length ? i : longest), 0);
+			queues[queue] = queues[victim].splice(Math.floor(queues[victim].length / 2));
+		}
+		const batch: number[] = [];
+		let batchSize = 0;
+		while (
+			queues[queue].length &&
+			batch.length < WORKER_BATCH_MAX_FILES &&
+			(!batch.length || batchSize + blobs[queues[queue][0]].size <= WORKER_BATCH_MAX_SIZE)
+		) {
+			const index = queues[queue].shift() as number;
+			batch.push(index);
+			batchSize += blobs[index].size;
+		}
+		return batch;
+	};
+
+	return yield* eventToGenerator<{ index: number; progress: number; sha256?: string }, string[]>(
+		(yieldCallback, returnCallback, rejectCallack) => {
+			const counters = createProgressCounters(blobs.length);
+			/** Bytes hashed of the files being hashed, as last reported */
+			const inFlight = new Map<number, number>();
+			const sampler =
+				counters &&
+				setInterval(() => {
+					for (const [index, lastBytesDone] of inFlight) {
+						const bytesDone = Number(Atomics.load(counters, index));
+						if (bytesDone !== lastBytesDone) {
+							inFlight.set(index, bytesDone);
+							yieldCallback({ index, progress: bytesDone / blobs[index].size });
+						}
+					}
+				}, progressInterval);
+
+			const runWorker = async (queue: number) => {
+				const worker = await getWorker(poolSize);
+				/** Whether the worker answered all the messages sent to it, and can go back to the pool */
+				let reusable = true;
+				try {
+					for (let batch = nextBatch(queue); batch.length; batch = nextBatch(queue)) {
+						opts?.abortSignal?.throwIfAborted();
+						await new Promise<void>((resolve, reject) => {
+							const cancellation = createCancellation(worker);
+							let cancelTimer: ReturnType<typeof setTimeout> | undefined;
+							const cleanup = () => {
+								clearTimeout(cancelTimer);
+								worker.removeEventListener("message", onMessage);
+								worker.removeEventListener("error", onError);
+								opts?.abortSignal?.removeEventListener("abort", onAbort);
+							};
+							const fail = (err: unknown) => {
+								cleanup();
+								reusable = false;
+								reject(err);
+							};
+							const onMessage = (event: MessageEvent) => {
+								if (event.data.batchDone || event.data.cancelled) {
+									cleanup();
+									resolve();
+								} else if (event.data.sha256) {
+									inFlight.delete(event.data.index);
+									results[event.data.index] = event.data.sha256;
+									yieldCallback({ index: event.data.index, progress: 1, sha256: event.data.sha256 });
+								} else if (event.data.progress !== undefined) {
+									yieldCallback({ index: event.data.index, progress: event.data.progress });
+								} else {
+									fail(event);
+								}
+							};
+							const onError = (event: ErrorEvent) => fail(event.error);
+							const onAbort = () => {
+								cancellation.cancel();
+								cancelTimer = setTimeout(() => fail(opts?.abortSignal?.reason), CANCEL_TIMEOUT);
+							};
+							worker.addEventListener("message", onMessage);
+							worker.addEventListener("error", onError);
+							opts?.abortSignal?.addEventListener("abort", onAbort);
+							for (const index of batch) {
+								inFlight.set(index, 0);
+							}
+							worker.postMessage({
+								id: cancellation.id,
+								files: batch.map((i) => blobs[i]),
+								indices: batch,
+								poolSize,
+								counters,
+								cancel: cancellation.flag,
+							});
+						});
+					}
+					// The last batch may have been cancelled
+					opts?.abortSignal?.throwIfAborted();
+				} catch (err) {
+					failed = true;
+					if (reusable) {
+						freeWorker(worker, poolSize);
+					} else {
+						destroyWorker(worker);
+					}
+					throw err;
+				}
+				freeWorker(worker, poolSize);
+			};
+
+			return Promise.all(queues.map((_, queue) => runWorker(queue)))
+				.finally(() => clearInterval(sampler))
+				.then(() => returnCallback(results), rejectCallack);
+		}
+	);
+}
+
+const PREFIX_CHECK_SAMPLES = 8;
+const PREFIX_CHECK_SAMPLE_SIZE = 4096;
+
+/**
+ * Hash the start, the end and evenly spaced ranges of the first `end` bytes of the blob
+ */
+export async function prefixCheck(buffer: Blob, end: number): Promise<string> {
+	if (!wasmModule) {
+		wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
+	}
+
+	const sha256 = await wasmModule.createSHA256(false, { sizeHint: PREFIX_CHECK_SAMPLE_SIZE });
+	sha256.init();
+
+	try {
+		const step = Math.max(PREFIX_CHECK_SAMPLE_SIZE, Math.floor(end / PREFIX_CHECK_SAMPLES));
+		const starts = new Set([Math.max(0, end - PREFIX_CHECK_SAMPLE_SIZE)]);
+		for (let start = 0; start < end; start += step) {
+			starts.add(start);
+		}
+
+		for (const start of [...starts].sort((a, b) => a - b)) {
+			const sample = buffer.slice(start, Math.min(end, start + PREFIX_CHECK_SAMPLE_SIZE));
+			sha256.update(new Uint8Array(await sample.arrayBuffer()));
 		}
 
 		return sha256.digest("hex");
+	} finally {
+		sha256.destroy();
 	}
+}
 
-	if (!cryptoModule) {
-		cryptoModule = await import("./sha256-node");
+async function* sha256Appendable(
+	buffer: Blob,
+	digestIndex: SHA256DigestIndexStore,
+	abortSignal?: AbortSignal
+): AsyncGenerator<number, string> {
+	if (!wasmModule) {
+		wasmModule = await import("../vendor/hash-wasm/sha256-wrapper");
 	}
 
-	return yield* cryptoModule.sha256Node(buffer, { abortSignal: opts?.abortSignal });
+	const sha256 = await wasmModule.createSHA256(false, { sizeHint: buffer.size });
+	const entry = await digestIndex.load();
+	const total = buffer.size;
+	const newOffset = total - (total % 64);
+	let bytesDone = 0;
+
+	try {
+		if (
+			entry &&
+			entry.offset &&
+			entry.size <= total &&
+			(await prefixCheck(buffer, entry.offset)) === entry.prefixCheck
+		) {
+			sha256.load(entry.state);
+			bytesDone = entry.offset;
+			yield bytesDone / total;
+		} else {
+			sha256.init();
+		}
+
+		let state = bytesDone === newOffset ? sha256.save() : undefined;
+		const reader = buffer.slice(bytesDone).stream().getReader();
+
+		while (true) {
+			const { done, value } = await reader.read();
+
+			if (done) {
+				break;
+			}
+
+			if (!state && bytesDone + value.length >= newOffset) {
+				// Split the chunk to capture the state right at the block boundary
+				const head = newOffset - bytesDone;
+				sha256.update(value.subarray(0, head));
+				state = sha256.save();
+				sha256.update(value.subarray(head));
+			} else {
+				sha256.update(value);
+			}
+			bytesDone += value.length;
+
+			yield bytesDone / total;
+
+			abortSignal?.throwIfAborted();
+		}
+
+		const digest = sha256.digest("hex");
+
+		if (state) {
+			await digestIndex.save({
+				size: total,
+				offset: newOffset,
+				state,
+				prefixCheck: await prefixCheck(buffer, newOffset),
+			});
+		}
+
+		return digest;
+	} finally {
+		sha256.destroy();
+	}
 }
 
 // eslint-disable-next-line @typescript-eslint/consistent-type-imports
 let cryptoModule: typeof import("./sha256-node");
 // eslint-disable-next-line @typescript-eslint/consistent-type-imports
 let wasmModule: typeof import("../vendor/hash-wasm/sha256-wrapper");
+// eslint-disable-next-line @typescript-eslint/consistent-type-imports
+let threadsModule: typeof import("../vendor/hash-wasm/sha256-threads-wrapper");
@@ -1,7 +1,14 @@
 import { configDefaults, defineConfig } from "vitest/config";
 
 export default defineConfig({
+	server: {
+		// Cross-origin isolation, for SharedArrayBuffer and the threaded build of the sha256 module
+		headers: {
+			"Cross-Origin-Opener-Policy": "same-origin",
+			"Cross-Origin-Embedder-Policy": "require-corp",
+		},
+	},
 	test: {
-		exclude: [...configDefaults.exclude, "src/utils/FileBlob.spec.ts"],
+		exclude: [...configDefaults.exclude, "src/utils/FileBlob.spec.ts", "src/utils/sha256-cache-node.spec.ts"],
 	},
 });